@@ -0,0 +1,118 @@
+#ifndef __AUTOMATIONQUEUE_H__
+#define __AUTOMATIONQUEUE_H__
+
+#include "JuceHeader.h"
+
+//==============================================================================
+/**
+ * A parameter change that should take effect at a particular sample of the
+ * next processed block.
+ */
+struct AutomationEvent
+{
+    int sampleOffset;       // From the start of the next block
+    int parameterIndex;
+    float value;            // Normalised 0-1, as for setParameter()
+};
+
+//==============================================================================
+/**
+ * Preallocated single producer, single consumer queue of timestamped
+ * parameter changes.
+ *
+ * JUCE only passes the latest value of each parameter on to the plugin, so
+ * changes that should land part way through a block are queued here (by a
+ * wrapper, a sequencer or the offline renderer) and consumed by the audio
+ * thread at the start of the next block. Events for later blocks stay
+ * queued until their block comes. Neither side locks or allocates; when the
+ * queue is full new events are dropped and push() returns false.
+ */
+class AutomationQueue
+{
+public:
+    AutomationQueue (const int capacity = 1024)
+        : fifo (capacity), events ((size_t) capacity), held ((size_t) capacity)
+    {
+    }
+
+    ~AutomationQueue() {}
+
+    bool push (const AutomationEvent& event) noexcept
+    {
+        // Events held for a later block count towards the capacity
+        if (fifo.getFreeSpace() <= numHeld.get())
+            return false;
+        int start1, size1, start2, size2;
+        fifo.prepareToWrite (1, start1, size1, start2, size2);
+        if (size1 == 0)
+            return false;
+        events[start1] = event;
+        fifo.finishedWrite (1);
+        return true;
+    }
+
+    // Copies the queued events that fall inside a block of numSamples
+    // samples into dest, which needs room for getCapacity() events, sorted
+    // by sampleOffset, and returns how many were copied. Events at or after
+    // the end of the block stay queued, with numSamples taken off their
+    // offsets so that they count from the start of the block after. Events
+    // pushed in time order are already sorted, so this is linear in the
+    // number of events.
+    int popBlock (AutomationEvent* dest, const int numSamples) noexcept
+    {
+        // Held events were pushed before anything still in the fifo
+        const int numAlreadyHeld = numHeld.get();
+        for (int i = 0; i < numAlreadyHeld; ++i)
+            dest[i] = held[i];
+
+        int start1, size1, start2, size2;
+        fifo.prepareToRead (getCapacity() - numAlreadyHeld, start1, size1, start2, size2);
+        AutomationEvent* popped = dest + numAlreadyHeld;
+        for (int i = 0; i < size1; ++i)
+            popped[i] = events[start1 + i];
+        for (int i = 0; i < size2; ++i)
+            popped[size1 + i] = events[start2 + i];
+        const int numEvents = numAlreadyHeld + size1 + size2;
+        // Counted as held before their space in the fifo is given back, so
+        // that push() never sees more room than there is
+        numHeld.set (numEvents);
+        fifo.finishedRead (size1 + size2);
+
+        // Insertion sort keeps events with the same offset in the order they
+        // were pushed
+        for (int i = 1; i < numEvents; ++i)
+        {
+            const AutomationEvent event = dest[i];
+            int j = i;
+            for (; j > 0 && dest[j - 1].sampleOffset > event.sampleOffset; --j)
+                dest[j] = dest[j - 1];
+            dest[j] = event;
+        }
+
+        int numDue = 0;
+        while (numDue < numEvents && dest[numDue].sampleOffset < numSamples)
+            ++numDue;
+        for (int i = numDue; i < numEvents; ++i)
+        {
+            held[i - numDue] = dest[i];
+            held[i - numDue].sampleOffset -= numSamples;
+        }
+        numHeld.set (numEvents - numDue);
+        return numDue;
+    }
+
+    int getCapacity() const noexcept { return fifo.getTotalSize(); }
+
+    // Bytes allocated for the queue
+    size_t getMemoryUsage() const noexcept { return sizeof(AutomationEvent) * (size_t) fifo.getTotalSize() * 2; }
+
+private:
+    AbstractFifo fifo;
+    HeapBlock<AutomationEvent> events;
+    HeapBlock<AutomationEvent> held;    // For later blocks, sorted
+    Atomic<int> numHeld;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AutomationQueue);
+};
+
+#endif
@@ -29,7 +29,6 @@
 
 #include "CrossoverFilter.h"
 #include <cmath>
-#include <vector>
 
 #if JUCE_INTEL
  #define JUCE_SNAP_TO_ZERO(n)    if (! (n < -1.0e-8f || n > 1.0e-8f)) n = 0;
@@ -39,32 +38,24 @@
 
 CrossoverFilter::CrossoverFilter(bool highpass, bool linkwitzRiley) {
     active = false;
-    numerator.resize(5, 0);
-    denominator.resize(5, 0);
     this->linkwitzRiley = linkwitzRiley;
-    // Allocate memory for delay line based on the number of
-    // coefficients generated. Initialize vectors with values of 0.
-    inputDelayBuf.resize(int(numerator.size())-1, 0);
-    outputDelayBuf.resize(int(denominator.size())-1, 0);
-    // Store the delay size of delay buffers
-    inputDelaySize = inputDelayBuf.size();
-    outputDelaySize = outputDelayBuf.size();
+    std::fill(coefficients, coefficients + kMaxStages * 5, 0);
+    std::fill(state, state + kMaxStages * 2, 0);
+    kernels = &DSPKernels::get(DSPKernels::kGeneric);
     prevFreq = 0;
 }
 
-void CrossoverFilter::makeCrossover(
+bool CrossoverFilter::makeCrossover(
         const double crossoverFrequency,
         const int sampleRate,
         const bool linkwitzRiley,
         const bool highpass
     ) noexcept
 {
-    //const SpinLock::ScopedLockType sl (processLock);
-
     if(sampleRate < 1)
-        return;
+        return false;
     if(crossoverFrequency == prevFreq || crossoverFrequency <= 0 || crossoverFrequency > sampleRate * 0.5)
-        return;
+        return false;
     this->linkwitzRiley = linkwitzRiley;
     prevFreq = crossoverFrequency;
 
@@ -77,7 +68,9 @@ void CrossoverFilter::makeCrossover(
     // Warp the frequency to convert from continuous to discrete time cutoff
     const double wd1 = 1.0 / tan(M_PI*(crossoverFrequency/sampleRate));
 
-    // Calculate coefficients from equation and store in a vector
+    // Calculate coefficients from equation. They're only needed until
+    // they've been copied into the sections below.
+    double numerator[3], denominator[3];
     numerator[0] = 1.0 / (1.0 + q*wd1 + pow(wd1, 2));
     numerator[1] = 2 * numerator[0];
     numerator[2] = numerator[0];
@@ -92,103 +85,47 @@ void CrossoverFilter::makeCrossover(
         numerator[1] = -numerator[1] * pow(wd1, 2);
         numerator[2] = numerator[2] * pow(wd1, 2);
     }
-    std::fill(inputDelayBuf.begin(), inputDelayBuf.end(), 0);
-    std::fill(outputDelayBuf.begin(), outputDelayBuf.end(), 0);
-    active = true;
-    // If the filter is using the Linkwitz-Riley filter structure,
-    // convolve the numerator and denominator generated for the 2nd
-    // order butterworth filter with themselves. This creates the 5
-    // coefficients of 2 cascaded 2nd order butterworth filters needed
-    // for this filter structure.
-
-    /*
-    if(linkwitzRiley) {
-        numerator = convolveCoefficients(numerator, numerator);
-        denominator = convolveCoefficients(denominator, denominator);
+    // Copy the coefficients into both sections, normalised by the first
+    // denominator coefficient (always 1 in the current implementation, so
+    // added only for generalization of the method for future use)
+    for(int s = 0; s < kMaxStages; ++s) {
+        double* c = coefficients + s * 5;
+        c[0] = numerator[0] / denominator[0];
+        c[1] = numerator[1] / denominator[0];
+        c[2] = numerator[2] / denominator[0];
+        c[3] = denominator[1] / denominator[0];
+        c[4] = denominator[2] / denominator[0];
     }
-    */
+    std::fill(state, state + kMaxStages * 2, 0);
+    active = true;
+    // A Linkwitz-Riley filter is the 2nd order butterworth squared. Rather
+    // than convolving the coefficients with themselves, applyFilter runs
+    // the two sections in series, which is equivalent and numerically
+    // better behaved.
+    return true;
 }
 
-void CrossoverFilter::applyFilter(float* const samples, float* const output, const int numSamples) noexcept {
-    //const SpinLock::ScopedLockType sl (processLock);
+void CrossoverFilter::copyCoefficientsFrom(const CrossoverFilter& other) noexcept {
+    std::copy(other.coefficients, other.coefficients + kMaxStages * 5, coefficients);
+    linkwitzRiley = other.linkwitzRiley;
+    active = other.active;
+    prevFreq = other.prevFreq;
+}
+
+void CrossoverFilter::applyFilter(const float* const samples, float* const output, const int numSamples) noexcept {
     if(active){
-        for(int i = 0; i < numSamples; ++i) {
-            // Perform filtering using doubles for greater precision
-            const double in = samples[i];
-            // Increment the write pointer of the delay buffer storing input
-            // samples
-            ++inputDelayBufWritePtr;
-            // Wrap values to within size of buffer. Prevents an integer
-            // overflow
-            inputDelayBufWritePtr = (inputDelayBufWritePtr+inputDelaySize)%inputDelaySize;
-
-            // Increment the write pointer of the delay buffer storing output
-            // samples
-            ++outputDelayBufWritePtr;
-            // Wrap values to withink size of buffer. Prevents an integer
-            // overflow
-            outputDelayBufWritePtr = (outputDelayBufWritePtr+outputDelaySize)%outputDelaySize;
-
-            // Set the current value of the input delay buffer to the value of
-            // the sample provided to the function
-            inputDelayBuf[(inputDelayBufWritePtr+inputDelaySize)%inputDelaySize] = in;
-
-            // Initialize a variable to store an output value
-            double y = 0;
-            // Accumulate each sample in the input delay buffer, multiplied by
-            // it's corresponding coefficient
-            for(unsigned int j = 0; j < numerator.size(); j++) {
-                y += inputDelayBuf[(inputDelayBufWritePtr-j+inputDelaySize)%inputDelaySize] * numerator[j];
-            }
-            // decumulate each sample in the output delay buffer (aside from
-            // the current index), multiplied by it's corresponding coefficient
-            for(unsigned int k = 1; k < denominator.size(); k++) {
-                y -= outputDelayBuf[(outputDelayBufWritePtr-k+outputDelaySize)%outputDelaySize] * denominator[k];
-            }
-            // Scale by first coefficient in the denominator (always 1 in
-            // current implementation, so added only for generalization of the
-            // method for future use)
-            y /= denominator[0];
-
-            // Taken from Juce's IIR filter code. Deals with some bug that I
-            // haven't looked in to...
-            //JUCE_SNAP_TO_ZERO(y);
-
-            // Store the calculated output sample in the output sample delay
-            // buffer
-            outputDelayBuf[(outputDelayBufWritePtr+outputDelaySize)%outputDelaySize] = y;
-
-            output[i] = y;
-        }
+        // Filtering is performed using doubles for greater precision. If
+        // using the Linkwitz Riley filter structure, the 2nd order
+        // butterworth is applied twice in a single pass to create a 4th
+        // order Linkwitz Riley filter.
+        kernels->biquadCascade(coefficients, state, linkwitzRiley ? 2 : 1, samples, output, numSamples);
     }
 }
 
-// Could have been used for linkwitz riley coefficient calculation. Needs
-// memory efficiency improvments to work in this context live...
-std::vector<double> CrossoverFilter::convolveCoefficients(std::vector<double> const &f, std::vector<double> const &g) {
-    // Calculate the size of input vectors
-    const int nf = f.size();
-    const int ng = g.size();
-    // Calculate the size of output vector as the combined size of both
-    // input vectors, minus 1
-    const int n  = nf + ng - 1;
-    // Initialize vector of the same input type as input vectors
-    // Allocate memory for all elements of the output to be calculated
-    std::vector<double> out(n, double());
-    // For each output element...
-    for(auto i(0); i < n; ++i) {
-        // Calculate minimum and maximum indexes to iterate over each
-        // vector
-        const int jmn = (i >= ng - 1)? i - (ng - 1) : 0;
-        const int jmx = (i <  nf - 1)? i : nf - 1;
-        // Accumulate the multiplication of elements in both vectors,
-        // based on the indexes calculated, to give the output value at
-        // the current output index
-        for(auto j(jmn); j <= jmx; ++j) {
-            out[i] += (f[j] * g[i - j]);
-        }
-    }
-    return out;
+void CrossoverFilter::applyFilterMix(const float* const samplesA, const float* const samplesB, const float gainA, const float gainB,
+                                     float* const output, const int numSamples) noexcept {
+    if(active)
+        kernels->biquadCascadeMix(coefficients, state, linkwitzRiley ? 2 : 1, samplesA, samplesB, gainA, gainB, output, numSamples);
 }
 
 #undef JUCE_SNAP_TO_ZERO
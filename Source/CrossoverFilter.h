@@ -31,57 +31,76 @@
 #define __PARAMETRICEQFILTER_H_6E48F605__
 
 #define _USE_MATH_DEFINES
-#include "../JuceLibraryCode/JuceHeader.h"
+#include "JuceHeader.h"
+#include "DSPKernels.h"
 
 //==============================================================================
 /**
  * This class implements a biquad parametric EQ section according
  * to the equations in the Reiss and McPherson text.
+ *
+ * Only the coefficients and the recursive state of its sections are kept;
+ * nothing is allocated.
  */
 
-class CrossoverFilter : public IIRFilter
+class CrossoverFilter
 {
 public:
     //==============================================================================
 
     CrossoverFilter(bool highpass, bool linkwitzRiley);
     ~CrossoverFilter() {}
-    void makeCrossover (
+    // Returns true if the coefficients were recalculated
+    bool makeCrossover (
         const double crossoverFrequency, 
         const int sampleRate, 
         const bool linkwitzRiley, 
         const bool highpass
     ) noexcept;
 
-    void applyFilter(float* const samples, float* const output, const int numSamples) noexcept;
+    void applyFilter(const float* const samples, float* const output, const int numSamples) noexcept;
+    // Clears the sections' state, e.g. before filtering a signal that
+    // doesn't follow on from the last one
+    void reset() noexcept { std::fill(state, state + kMaxStages * 2, 0.0); }
+    // Filters gainA * samplesA + gainB * samplesB, e.g. to split the mid or
+    // side of a stereo pair without encoding it first
+    void applyFilterMix(const float* const samplesA, const float* const samplesB, const float gainA, const float gainB,
+                        float* const output, const int numSamples) noexcept;
 
 
-    /** Makes this filter duplicate the set-up of another one.
+    /** Makes this filter duplicate the set-up of another one. The state is
+        kept, so the filter carries on from where it was with the new
+        coefficients, and makeCrossover() won't recalculate them for the
+        same frequency.
      */
-    //void copyCoefficientsFrom (const CrossoverFilter& other) noexcept;
+    void copyCoefficientsFrom (const CrossoverFilter& other) noexcept;
 
     bool linkwitzRileyActive() { return linkwitzRiley; }
 
+    // Coefficients (b0, b1, b2, a1, a2) of the section(s) applyFilter runs,
+    // and how many times over it runs them: none until makeCrossover has
+    // been called
+    const double* getCoefficients() const noexcept { return coefficients; }
+    int getNumStages() const noexcept { return active ? (linkwitzRiley ? 2 : 1) : 0; }
+
+    // Select the instruction set variant used by applyFilter
+    void setKernels(const DSPKernels& k) { kernels = &k; }
+
 private:
     //==============================================================================
-    // Vector used for dynamic allocation of numerators and denominators
-    // based on filter order
-    std::vector<double> numerator;
-    std::vector<double> denominator;
-    // Vector used for dynamic allocation of delay line size based on
-    // filter type
-    std::vector<double> inputDelayBuf;
-    std::vector<double> outputDelayBuf;
-    std::vector<double>::size_type inputDelaySize, outputDelaySize;
-    unsigned int inputDelayBufWritePtr, outputDelayBufWritePtr = 0;
-    SpinLock processLock;
+    // A Linkwitz-Riley crossover is two identical butterworth sections in
+    // series, each with its own state
+    enum { kMaxStages = 2 };
+    // Normalised coefficients (b0, b1, b2, a1, a2) and transposed direct
+    // form II state for each section, in the layout DSPKernels expects
+    double coefficients[kMaxStages * 5];
+    double state[kMaxStages * 2];
+    const DSPKernels* kernels;
+    bool active;
     bool linkwitzRiley;
     double prevFreq;
 
     JUCE_LEAK_DETECTOR (CrossoverFilter);
-
-    // Convolution function adapted from: http://stackoverflow.com/questions/24518989/how-to-perform-1-dimensional-valid-convolution
-    std::vector<double> convolveCoefficients(std::vector<double> const &f, std::vector<double> const &g);
 };
 
 
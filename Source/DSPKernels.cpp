@@ -0,0 +1,89 @@
+#include "DSPKernels.h"
+#include "GainCurve.h"
+#include <cstring>
+
+// Portable variant, compiled for whatever the project's baseline is
+#if defined (__GNUC__) && ! defined (__clang__)
+ #pragma GCC push_options
+ // Lets the float to int conversions and selects in the kernels be vectorised
+ #pragma GCC optimize ("no-trapping-math")
+#endif
+
+#define DSPKERNELS_NAMESPACE    DSPKernelsGeneric
+#define DSPKERNELS_TABLE        dspKernelsGeneric
+#define DSPKERNELS_ISA          DSPKernels::kGeneric
+#define DSPKERNELS_NAME         "generic"
+#include "DSPKernelsImpl.h"
+
+#if defined (__GNUC__) && ! defined (__clang__)
+ #pragma GCC pop_options
+#endif
+
+#if DSPKERNELS_X86_VARIANTS
+// Defined in DSPKernels_SSE2.cpp, DSPKernels_AVX2.cpp and DSPKernels_AVX512.cpp
+extern const DSPKernels dspKernelsSSE2;
+extern const DSPKernels dspKernelsAVX2;
+extern const DSPKernels dspKernelsAVX512;
+#endif
+
+namespace
+{
+    const DSPKernels* getTable(const DSPKernels::Isa isa)
+    {
+        switch(isa) {
+           #if DSPKERNELS_X86_VARIANTS
+            case DSPKernels::kSSE2:     return &dspKernelsSSE2;
+            case DSPKernels::kAVX2:     return &dspKernelsAVX2;
+            case DSPKernels::kAVX512:   return &dspKernelsAVX512;
+           #endif
+            default:                    return &dspKernelsGeneric;
+        }
+    }
+
+    const DSPKernels& chooseBest()
+    {
+        // Try the widest instruction set first
+        for(int isa = DSPKernels::kNumIsas - 1; isa > DSPKernels::kGeneric; --isa) {
+            if(DSPKernels::isSupported((DSPKernels::Isa) isa))
+                return *getTable((DSPKernels::Isa) isa);
+        }
+        return dspKernelsGeneric;
+    }
+}
+
+bool DSPKernels::isSupported(const Isa isa)
+{
+    switch(isa) {
+        case kGeneric:
+            return true;
+       #if DSPKERNELS_X86_VARIANTS
+        // These also check that the OS saves the wider registers
+        case kSSE2:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("sse2");
+        case kAVX2:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+        case kAVX512:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx2")
+                && __builtin_cpu_supports("fma");
+       #endif
+        default:
+            return false;
+    }
+}
+
+const DSPKernels& DSPKernels::getBest()
+{
+    // Initialised (and the CPU checked) on first use only
+    static const DSPKernels& best = chooseBest();
+    return best;
+}
+
+const DSPKernels& DSPKernels::get(const Isa isa)
+{
+    if(isSupported(isa))
+        return *getTable(isa);
+    return getBest();
+}
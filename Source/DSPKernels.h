@@ -0,0 +1,88 @@
+#ifndef __DSPKERNELS_H__
+#define __DSPKERNELS_H__
+
+#include "JuceHeader.h"
+
+// The x86 variants are compiled with function level target pragmas, which
+// only GCC and Clang support. Other compilers build the generic variant only.
+#if JUCE_INTEL && defined (__GNUC__)
+ #define DSPKERNELS_X86_VARIANTS 1
+#else
+ #define DSPKERNELS_X86_VARIANTS 0
+#endif
+
+//==============================================================================
+/**
+ * Table of the hot inner loops of the plugin, compiled once for each
+ * instruction set it can be dispatched to.
+ *
+ * The same source (DSPKernelsImpl.h) is built for a portable baseline and,
+ * on x86, for SSE2, AVX2+FMA and AVX-512. getBest() checks the CPU the first
+ * time it is called (from prepareToPlay) and returns the widest variant the
+ * CPU supports; objects then call through the table they were given.
+ *
+ * Every variant uses the same arithmetic, so output only differs between
+ * them by floating point rounding.
+ */
+struct DSPKernels
+{
+    enum Isa
+    {
+        kGeneric = 0,
+        kSSE2,
+        kAVX2,
+        kAVX512,
+        kNumIsas
+    };
+
+    // Runs numStages cascaded biquads over the input. Each stage takes five
+    // coefficients (b0, b1, b2, a1, a2, normalised so a0 is 1) and two state
+    // values (transposed direct form II). in and out may be the same.
+    void (*biquadCascade) (const double* coefficients, double* state, int numStages,
+                           const float* in, float* out, int numSamples);
+
+    // biquadCascade on gainA * inA[i] + gainB * inB[i], so that a mid/side
+    // encode happens as the input is read
+    void (*biquadCascadeMix) (const double* coefficients, double* state, int numStages,
+                              const float* inA, const float* inB, float gainA, float gainB,
+                              float* out, int numSamples);
+
+    // Peak level detection and static gain curve lookup. Writes the gain
+    // reduction in dB for each sample, using a GainCurve table.
+    void (*gainComputer) (const float* curveTable, const float* samples,
+                          float* reductionDb, int numSamples);
+
+    // Converts smoothed gain reduction in dB to a linear gain, including
+    // make-up gain
+    void (*decibelsToGain) (const float* reductionDb, float makeUpGain,
+                            float* gain, int numSamples);
+
+    // samples[i] *= gain[i]
+    void (*multiply) (float* samples, const float* gain, int numSamples);
+
+    // out[i] = sum of bands[b][i] over all bands, in a single pass
+    void (*sumBands) (float* out, const float* const* bands, int numBands, int numSamples);
+
+    // Sums the bands of a mid and a side signal and decodes the result to
+    // left (mid + side) and right (mid - side). The decode is done while
+    // adding the last band rather than as a separate pass.
+    void (*sumBandsMidSide) (float* left, float* right, const float* const* midBands,
+                             const float* const* sideBands, int numBands, int numSamples);
+
+    // out[i] = largest |signals[s][i]| over all signals, for a detector
+    // shared by a group of linked channels
+    void (*maxMagnitude) (float* out, const float* const* signals, int numSignals, int numSamples);
+
+    Isa isa;
+    const char* name;
+
+    //==============================================================================
+    // Widest variant supported by this CPU. The CPU is only checked once.
+    static const DSPKernels& getBest();
+    // A particular variant, for benchmarking. Falls back to getBest() if the
+    // CPU (or compiler) doesn't support the one asked for.
+    static const DSPKernels& get (Isa isa);
+    static bool isSupported (Isa isa);
+};
+
+#endif
@@ -0,0 +1,240 @@
+// Kernel bodies shared by every instruction set variant of DSPKernels.
+//
+// This file is included by DSPKernels*.cpp after all other headers and after
+// the instruction set has been selected with a target pragma, with
+// DSPKERNELS_NAMESPACE defined to a name unique to that variant. To keep
+// code compiled for a wider instruction set from leaking into the rest of
+// the plugin, nothing here may call inline functions or templates defined
+// in other headers - everything used is defined in this file, inside the
+// variant's namespace.
+//
+// Loops are written so that compilers can vectorise them: no branches on
+// the data (selects instead) and no calls to library maths functions, which
+// are replaced by polynomial approximations accurate to within 1e-4dB.
+
+namespace DSPKERNELS_NAMESPACE
+{
+    // log2 of a positive, normal float. Splits off the exponent and
+    // evaluates log2 of the mantissa (reduced to [sqrt(0.5), sqrt(2))) with
+    // the atanh series.
+    static inline float fastLog2 (const float x) noexcept
+    {
+        int32 bits;
+        memcpy (&bits, &x, sizeof (bits));
+        float exponent = (float) (((bits >> 23) & 255) - 127);
+        bits = (bits & 0x007fffff) | 0x3f800000;
+        float m;
+        memcpy (&m, &bits, sizeof (m));
+        const bool above = m > 1.41421356f;
+        m = above ? m * 0.5f : m;
+        exponent = above ? exponent + 1.0f : exponent;
+        const float t = (m - 1.0f) / (m + 1.0f);
+        const float t2 = t * t;
+        // 2/ln(2) * (t + t^3/3 + t^5/5 + t^7/7)
+        const float series = t * (2.88539008f + t2 * (0.96179669f + t2 * (0.57707801f + t2 * 0.41219858f)));
+        return exponent + series;
+    }
+
+    // 2^x for x in roughly [-126, 126]. Splits x into integer and fractional
+    // parts, builds 2^integer directly in the exponent bits and evaluates
+    // 2^fraction with a Taylor polynomial.
+    static inline float fastExp2 (float x) noexcept
+    {
+        x = x > -126.0f ? x : -126.0f;
+        x = x < 126.0f ? x : 126.0f;
+        // Round towards minus infinity
+        int whole = (int) x;
+        whole -= (x < (float) whole) ? 1 : 0;
+        const float f = x - (float) whole;
+        const float p = 1.0f + f * (0.693147181f + f * (0.240226507f + f * (0.0555041087f
+                        + f * (0.00961812911f + f * (0.00133335581f + f * (0.000154035304f
+                        + f * 0.0000152527338f))))));
+        const int32 bits = (whole + 127) << 23;
+        float scale;
+        memcpy (&scale, &bits, sizeof (scale));
+        return scale * p;
+    }
+
+    static void biquadCascade (const double* coefficients, double* state, int numStages,
+                               const float* in, float* out, int numSamples)
+    {
+        // Stages are run one after the other inside the sample loop so the
+        // whole cascade takes a single pass over the buffer
+        for (int i = 0; i < numSamples; ++i)
+        {
+            double x = in[i];
+            for (int s = 0; s < numStages; ++s)
+            {
+                const double* c = coefficients + s * 5;
+                double* z = state + s * 2;
+                const double y = c[0] * x + z[0];
+                z[0] = c[1] * x - c[3] * y + z[1];
+                z[1] = c[2] * x - c[4] * y;
+                x = y;
+            }
+            out[i] = (float) x;
+        }
+    }
+
+    static void biquadCascadeMix (const double* coefficients, double* state, int numStages,
+                                  const float* inA, const float* inB, float gainA, float gainB,
+                                  float* out, int numSamples)
+    {
+        for (int i = 0; i < numSamples; ++i)
+        {
+            double x = gainA * inA[i] + gainB * inB[i];
+            for (int s = 0; s < numStages; ++s)
+            {
+                const double* c = coefficients + s * 5;
+                double* z = state + s * 2;
+                const double y = c[0] * x + z[0];
+                z[0] = c[1] * x - c[3] * y + z[1];
+                z[1] = c[2] * x - c[4] * y;
+                x = y;
+            }
+            out[i] = (float) x;
+        }
+    }
+
+    static void gainComputer (const float* curveTable, const float* samples,
+                              float* reductionDb, int numSamples)
+    {
+        // 20 * log10(2), to convert log2 to dB
+        const float dbPerLog2 = 6.02059991f;
+        const float minLevel = GainCurve::kMinLevel;
+        const float maxLevel = GainCurve::kMaxLevel;
+        const float steps = GainCurve::kStepsPerDecibel;
+        // Level detection and the table lookup are done in separate passes.
+        // The first (with the logarithm) vectorises everywhere; the second
+        // is a gather, which compilers vectorise less reliably.
+        for (int i = 0; i < numSamples; ++i)
+        {
+            //Level detection- peak detector, floored at -120dB
+            const float sample = samples[i];
+            float magnitude = sample < 0 ? -sample : sample;
+            magnitude = magnitude > 0.000001f ? magnitude : 0.000001f;
+            float level = dbPerLog2 * fastLog2 (magnitude);
+            level = level > minLevel ? level : minLevel;
+            level = level < maxLevel ? level : maxLevel;
+            // Store the position in the table for the second pass
+            reductionDb[i] = (level - minLevel) * steps;
+        }
+        for (int i = 0; i < numSamples; ++i)
+        {
+            //Gain computer- interpolated lookup of the static curve
+            const float position = reductionDb[i];
+            const int index = (int) position;
+            const float fraction = position - (float) index;
+            reductionDb[i] = curveTable[index] + fraction * (curveTable[index + 1] - curveTable[index]);
+        }
+    }
+
+    static void decibelsToGain (const float* reductionDb, float makeUpGain,
+                                float* gain, int numSamples)
+    {
+        // log2(10) / 20, to convert dB to a power of 2
+        const float log2PerDb = 0.166096405f;
+        for (int i = 0; i < numSamples; ++i)
+            gain[i] = fastExp2 ((makeUpGain - reductionDb[i]) * log2PerDb);
+    }
+
+    static void multiply (float* samples, const float* gain, int numSamples)
+    {
+        for (int i = 0; i < numSamples; ++i)
+            samples[i] *= gain[i];
+    }
+
+    static void sumBands (float* out, const float* const* bands, int numBands, int numSamples)
+    {
+        if (numBands <= 0)
+        {
+            for (int i = 0; i < numSamples; ++i)
+                out[i] = 0;
+            return;
+        }
+        // Two bands at a time, so the output is read and written half as
+        // often as adding the bands one by one
+        const float* first = bands[0];
+        for (int i = 0; i < numSamples; ++i)
+            out[i] = first[i];
+        int b = 1;
+        for (; b + 1 < numBands; b += 2)
+        {
+            const float* x = bands[b];
+            const float* y = bands[b + 1];
+            for (int i = 0; i < numSamples; ++i)
+                out[i] += x[i] + y[i];
+        }
+        if (b < numBands)
+        {
+            const float* x = bands[b];
+            for (int i = 0; i < numSamples; ++i)
+                out[i] += x[i];
+        }
+    }
+
+    static void sumBandsMidSide (float* left, float* right, const float* const* midBands,
+                                 const float* const* sideBands, int numBands, int numSamples)
+    {
+        if (numBands <= 0)
+        {
+            for (int i = 0; i < numSamples; ++i)
+                left[i] = right[i] = 0;
+            return;
+        }
+        const int last = numBands - 1;
+        const float* mid = midBands[last];
+        const float* side = sideBands[last];
+        if (last == 0)
+        {
+            for (int i = 0; i < numSamples; ++i)
+            {
+                const float m = mid[i];
+                const float s = side[i];
+                left[i] = m + s;
+                right[i] = m - s;
+            }
+            return;
+        }
+        // Sum all but the last band, then add it and decode in one pass
+        sumBands (left, midBands, last, numSamples);
+        sumBands (right, sideBands, last, numSamples);
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const float m = left[i] + mid[i];
+            const float s = right[i] + side[i];
+            left[i] = m + s;
+            right[i] = m - s;
+        }
+    }
+
+    static void maxMagnitude (float* out, const float* const* signals, int numSignals, int numSamples)
+    {
+        for (int i = 0; i < numSamples; ++i)
+            out[i] = 0;
+        for (int s = 0; s < numSignals; ++s)
+        {
+            const float* x = signals[s];
+            for (int i = 0; i < numSamples; ++i)
+            {
+                const float magnitude = x[i] < 0 ? -x[i] : x[i];
+                out[i] = magnitude > out[i] ? magnitude : out[i];
+            }
+        }
+    }
+}
+
+extern const DSPKernels DSPKERNELS_TABLE;
+const DSPKernels DSPKERNELS_TABLE =
+{
+    DSPKERNELS_NAMESPACE::biquadCascade,
+    DSPKERNELS_NAMESPACE::biquadCascadeMix,
+    DSPKERNELS_NAMESPACE::gainComputer,
+    DSPKERNELS_NAMESPACE::decibelsToGain,
+    DSPKERNELS_NAMESPACE::multiply,
+    DSPKERNELS_NAMESPACE::sumBands,
+    DSPKERNELS_NAMESPACE::sumBandsMidSide,
+    DSPKERNELS_NAMESPACE::maxMagnitude,
+    DSPKERNELS_ISA,
+    DSPKERNELS_NAME
+};
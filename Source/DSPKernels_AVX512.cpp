@@ -0,0 +1,29 @@
+#include "DSPKernels.h"
+#include "GainCurve.h"
+#include <cstring>
+
+#if DSPKERNELS_X86_VARIANTS
+
+// Everything included below this point is compiled for AVX512
+#if defined (__clang__)
+ #pragma clang attribute push (__attribute__ ((target ("avx512f,avx2,fma"))), apply_to = function)
+#else
+ #pragma GCC push_options
+ #pragma GCC target ("avx512f,avx2,fma")
+ // Lets the float to int conversions and selects in the kernels be vectorised
+ #pragma GCC optimize ("no-trapping-math")
+#endif
+
+#define DSPKERNELS_NAMESPACE    DSPKernelsAVX512
+#define DSPKERNELS_TABLE        dspKernelsAVX512
+#define DSPKERNELS_ISA          DSPKernels::kAVX512
+#define DSPKERNELS_NAME         "avx-512"
+#include "DSPKernelsImpl.h"
+
+#if defined (__clang__)
+ #pragma clang attribute pop
+#else
+ #pragma GCC pop_options
+#endif
+
+#endif
@@ -0,0 +1,29 @@
+#include "DSPKernels.h"
+#include "GainCurve.h"
+#include <cstring>
+
+#if DSPKERNELS_X86_VARIANTS
+
+// Everything included below this point is compiled for SSE2
+#if defined (__clang__)
+ #pragma clang attribute push (__attribute__ ((target ("sse2"))), apply_to = function)
+#else
+ #pragma GCC push_options
+ #pragma GCC target ("sse2")
+ // Lets the float to int conversions and selects in the kernels be vectorised
+ #pragma GCC optimize ("no-trapping-math")
+#endif
+
+#define DSPKERNELS_NAMESPACE    DSPKernelsSSE2
+#define DSPKERNELS_TABLE        dspKernelsSSE2
+#define DSPKERNELS_ISA          DSPKernels::kSSE2
+#define DSPKERNELS_NAME         "sse2"
+#include "DSPKernelsImpl.h"
+
+#if defined (__clang__)
+ #pragma clang attribute pop
+#else
+ #pragma GCC pop_options
+#endif
+
+#endif
@@ -0,0 +1,185 @@
+#include "DSPThreadPool.h"
+
+#if JUCE_MAC || JUCE_IOS
+ #include <dispatch/dispatch.h>
+#elif JUCE_WINDOWS
+ #include <windows.h>
+#else
+ #include <semaphore.h>
+ #include <errno.h>
+#endif
+
+namespace
+{
+    // How many times an idle worker scans for work before going to sleep
+    const int kSpinsBeforeSleep = 64;
+}
+
+//==============================================================================
+// A counting semaphore. JUCE's WaitableEvent takes a mutex to signal, which
+// the submitting thread mustn't; posting one of these doesn't.
+class DSPThreadPool::Semaphore
+{
+public:
+#if JUCE_MAC || JUCE_IOS
+    Semaphore()                 : semaphore(dispatch_semaphore_create(0)) {}
+    ~Semaphore()                { dispatch_release(semaphore); }
+    void post() noexcept        { dispatch_semaphore_signal(semaphore); }
+    void wait() noexcept        { dispatch_semaphore_wait(semaphore, DISPATCH_TIME_FOREVER); }
+private:
+    dispatch_semaphore_t semaphore;
+#elif JUCE_WINDOWS
+    Semaphore()                 : semaphore(CreateSemaphore(nullptr, 0, 0x7fffffff, nullptr)) {}
+    ~Semaphore()                { CloseHandle(semaphore); }
+    void post() noexcept        { ReleaseSemaphore(semaphore, 1, nullptr); }
+    void wait() noexcept        { WaitForSingleObject(semaphore, INFINITE); }
+private:
+    HANDLE semaphore;
+#else
+    Semaphore()                 { sem_init(&semaphore, 0, 0); }
+    ~Semaphore()                { sem_destroy(&semaphore); }
+    void post() noexcept        { sem_post(&semaphore); }
+    void wait() noexcept
+    {
+        while(sem_wait(&semaphore) != 0 && errno == EINTR)
+            continue;
+    }
+private:
+    sem_t semaphore;
+#endif
+
+    JUCE_DECLARE_NON_COPYABLE (Semaphore)
+};
+
+//==============================================================================
+class DSPThreadPool::Worker : public Thread
+{
+public:
+    Worker(DSPThreadPool& p, const int index)
+        : Thread("DSP worker " + String(index)), pool(p)
+    {
+    }
+
+    void run() override
+    {
+        int idleSpins = 0;
+        while(! threadShouldExit()) {
+            if(pool.stealWork()) {
+                idleSpins = 0;
+            } else if(++idleSpins < kSpinsBeforeSleep) {
+                Thread::yield();
+            } else {
+                // Counted as sleeping before the last look for work, so a
+                // batch published after that look is sure to post
+                ++pool.numSleeping;
+                if(! pool.stealWork() && ! threadShouldExit())
+                    pool.workAvailable->wait();
+                --pool.numSleeping;
+                idleSpins = 0;
+            }
+        }
+    }
+
+private:
+    DSPThreadPool& pool;
+};
+
+//==============================================================================
+DSPThreadPool::DSPThreadPool()
+    : workAvailable(new Semaphore())
+{
+    for(int i = 0; i < kMaxBatches; ++i) {
+        batches[i].function = nullptr;
+        batches[i].context = nullptr;
+        batches[i].numJobs = 0;
+    }
+    // The threads that submit work take part as well, so leave one core
+    // for them
+    const int numWorkers = jmax(1, SystemStats::getNumCpus() - 1);
+    for(int i = 0; i < numWorkers; ++i)
+        workers.add(new Worker(*this, i))->startThread(9);
+}
+
+DSPThreadPool::~DSPThreadPool()
+{
+    for(int i = 0; i < workers.size(); ++i)
+        workers.getUnchecked(i)->signalThreadShouldExit();
+    for(int i = 0; i < workers.size(); ++i)
+        workAvailable->post();
+    for(int i = 0; i < workers.size(); ++i)
+        workers.getUnchecked(i)->stopThread(1000);
+}
+
+void DSPThreadPool::run(JobFunction function, void* context, const int numJobs) noexcept
+{
+    if(numJobs <= 0)
+        return;
+
+    // Find a free slot. If there isn't one, every slot is busy with other
+    // instances' work and the workers have nothing to spare anyway.
+    Batch* batch = nullptr;
+    for(int i = 0; i < kMaxBatches && batch == nullptr; ++i)
+        if(batches[i].state.get() == kFree && batches[i].state.compareAndSetBool(kFilling, kFree))
+            batch = &batches[i];
+    if(batch == nullptr) {
+        for(int i = 0; i < numJobs; ++i)
+            function(context, i);
+        return;
+    }
+
+    batch->function = function;
+    batch->context = context;
+    batch->numJobs = numJobs;
+    batch->nextJob.set(0);
+    batch->numDone.set(0);
+    // Atomic operations are full barriers, so the fields above are visible
+    // to any worker that sees the batch as published
+    batch->state.set(kPublished);
+    // Wake no more workers than there are jobs for them to take. A post
+    // that finds no one waiting lets a worker skip its next sleep, which
+    // does no harm.
+    const int numToWake = jmin(numSleeping.get(), numJobs - 1);
+    for(int i = 0; i < numToWake; ++i)
+        workAvailable->post();
+
+    // Work on our own batch, taking every job no worker has claimed yet,
+    // then wait for the ones workers are still running
+    runJobs(*batch);
+    while(batch->numDone.get() < numJobs)
+        Thread::yield();
+
+    // Workers mark themselves as readers before checking the state, so once
+    // the slot is closing and has no readers none of them can touch it
+    batch->state.set(kClosing);
+    while(batch->numReaders.get() > 0)
+        Thread::yield();
+    batch->state.set(kFree);
+}
+
+bool DSPThreadPool::runJobs(Batch& batch) noexcept
+{
+    bool ranAny = false;
+    for(;;) {
+        const int job = (batch.nextJob += 1) - 1;
+        if(job >= batch.numJobs)
+            return ranAny;
+        batch.function(batch.context, job);
+        ++batch.numDone;
+        ranAny = true;
+    }
+}
+
+bool DSPThreadPool::stealWork() noexcept
+{
+    bool ranAny = false;
+    for(int i = 0; i < kMaxBatches; ++i) {
+        Batch& batch = batches[i];
+        if(batch.state.get() != kPublished)
+            continue;
+        ++batch.numReaders;
+        if(batch.state.get() == kPublished)
+            ranAny |= runJobs(batch);
+        --batch.numReaders;
+    }
+    return ranAny;
+}
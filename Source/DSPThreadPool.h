@@ -0,0 +1,92 @@
+#ifndef __DSPTHREADPOOL_H__
+#define __DSPTHREADPOOL_H__
+
+#include "JuceHeader.h"
+#include <memory>
+
+//==============================================================================
+/**
+ * Process-wide pool of worker threads shared by every plugin instance.
+ *
+ * An instance hands the pool a batch of independent jobs (e.g. one per
+ * channel for a processing stage) with run(). The batch is published in a
+ * fixed table of slots; idle workers scan the table and steal jobs from any
+ * published batch by atomically claiming the next job index, while the
+ * submitting thread works through its own batch too. run() returns once
+ * every job in the batch has finished.
+ *
+ * Nothing locks or allocates on the submitting thread, and because the
+ * submitter always takes part a batch completes even if no worker is free,
+ * so total throughput scales with cores however the host spreads instances
+ * over its own threads.
+ *
+ * A job belongs to whichever thread claims it first, and the submitter
+ * claims every job no worker has, so it never waits for a worker to wake
+ * up or get round to its batch: it only waits for jobs a worker has
+ * already started, which bounds the wait by the longest of those.
+ *
+ * Idle workers sleep on a semaphore. The submitter posts it, which doesn't
+ * lock, and only when the sleeping count says a worker is there to wake,
+ * so an idle pool costs nothing.
+ *
+ * Share it between instances with a SharedResourcePointer, created the
+ * first time an instance wants it.
+ */
+class DSPThreadPool
+{
+public:
+    DSPThreadPool();
+    ~DSPThreadPool();
+
+    typedef void (*JobFunction) (void* context, int jobIndex);
+
+    // Runs function(context, 0) ... function(context, numJobs-1), spread
+    // over the calling thread and any idle workers, and waits for them all.
+    // Jobs must be independent of each other. If every slot is in use the
+    // jobs are run on the calling thread.
+    void run (JobFunction function, void* context, const int numJobs) noexcept;
+
+    int getNumWorkers() const noexcept { return workers.size(); }
+
+    // Batches that can be in flight at once, i.e. instances processing at
+    // the same time
+    enum { kMaxBatches = 64 };
+
+private:
+    class Worker;
+    class Semaphore;
+
+    enum SlotState
+    {
+        kFree = 0,
+        kFilling,       // Claimed by a submitter, not yet visible to workers
+        kPublished,
+        kClosing        // Finished; waiting for workers to stop looking at it
+    };
+
+    struct Batch
+    {
+        Atomic<int> state;
+        Atomic<int> numReaders;     // Workers currently looking at this slot
+        Atomic<int> nextJob;
+        Atomic<int> numDone;
+        JobFunction function;
+        void* context;
+        int numJobs;
+    };
+
+    // Claims and runs jobs from a batch until there are none left. Returns
+    // true if any were run.
+    static bool runJobs (Batch& batch) noexcept;
+    // Called by workers: steals from any published batch
+    bool stealWork() noexcept;
+
+    Batch batches[kMaxBatches];
+    OwnedArray<Worker> workers;
+    std::unique_ptr<Semaphore> workAvailable;
+    Atomic<int> numSleeping;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DSPThreadPool);
+};
+
+#endif
@@ -0,0 +1,114 @@
+#include "GainCurve.h"
+#include <cmath>
+
+constexpr float GainCurve::kMinLevel;
+constexpr float GainCurve::kMaxLevel;
+constexpr float GainCurve::kStepsPerDecibel;
+constexpr float GainCurve::kMaxUpwardGain;
+constexpr float GainCurve::kGateRange;
+
+GainCurve::GainCurve()
+{
+    // Start with a curve that can never match real settings so that the
+    // first call to setParameters() always builds the table
+    type = kCompressor;
+    threshold = 0;
+    ratio = 0;
+    kneeWidth = -1;
+    for (int i = 0; i <= kTableSize; ++i)
+        table[i] = 0;
+}
+
+bool GainCurve::setParameters(
+        const CurveType type,
+        const float threshold,
+        const float ratio,
+        const float kneeWidth
+    ) noexcept
+{
+    if(type == this->type && threshold == this->threshold && ratio == this->ratio && kneeWidth == this->kneeWidth)
+        return false;
+    if(type == kCustom)
+        return false;
+
+    this->type = type;
+    this->threshold = threshold;
+    this->ratio = jmax(1.0f, ratio);
+    this->kneeWidth = jmax(0.0f, kneeWidth);
+
+    // Evaluate the curve at each table point and store the gain reduction
+    for (int i = 0; i < kTableSize; ++i)
+    {
+        const float inputLevel = kMinLevel + i / kStepsPerDecibel;
+        table[i] = inputLevel - computeOutputLevel(inputLevel);
+    }
+    table[kTableSize] = table[kTableSize-1];
+    return true;
+}
+
+void GainCurve::setCustomCurve(const std::function<float (float)>& transferFunction)
+{
+    type = kCustom;
+    for (int i = 0; i < kTableSize; ++i)
+    {
+        const float inputLevel = kMinLevel + i / kStepsPerDecibel;
+        table[i] = inputLevel - transferFunction(inputLevel);
+    }
+    table[kTableSize] = table[kTableSize-1];
+}
+
+float GainCurve::computeOutputLevel(const float x) const noexcept
+{
+    // Soft knee equations from Giannoulis, Massberg and Reiss, "Digital
+    // Dynamic Range Compressor Design - A Tutorial and Analysis". The knee is
+    // a quadratic spline between the two straight sections of the curve,
+    // centred on the threshold.
+    const float T = threshold;
+    const float R = ratio;
+    const float W = kneeWidth;
+    const float overshoot = 2 * (x - T);
+
+    switch (type)
+    {
+        case kCompressor:
+            if (overshoot < -W)
+                return x;
+            if (overshoot <= W && W > 0)
+                return x + (1 / R - 1) * pow(x - T + W / 2, 2) / (2 * W);
+            return T + (x - T) / R;
+
+        case kUpwardCompressor:
+        {
+            float y;
+            if (overshoot > W)
+                y = x;
+            else if (overshoot >= -W && W > 0)
+                y = x - (1 / R - 1) * pow(x - T - W / 2, 2) / (2 * W);
+            else
+                y = T + (x - T) / R;
+            return jmin(y, x + kMaxUpwardGain);
+        }
+
+        case kExpander:
+            if (overshoot > W)
+                return x;
+            if (overshoot >= -W && W > 0)
+                return x - (R - 1) * pow(x - T - W / 2, 2) / (2 * W);
+            return T + (x - T) * R;
+
+        case kGate:
+            if (overshoot > W)
+                return x;
+            if (overshoot >= -W && W > 0)
+            {
+                // Raised cosine fade of the attenuation across the knee
+                const float position = (x - (T - W / 2)) / W;
+                return x - kGateRange * 0.5f * (1 + cos(float_Pi * position));
+            }
+            return x - kGateRange;
+
+        case kCustom:
+        default:
+            return x;
+    }
+}
@@ -0,0 +1,103 @@
+#ifndef __GAINCURVE_H__
+#define __GAINCURVE_H__
+
+#include "JuceHeader.h"
+#include <functional>
+
+//==============================================================================
+/**
+ * Static transfer function of a dynamics processor, baked into a table
+ * indexed by input level in dB.
+ *
+ * The table stores the gain reduction (input level - output level, in dB) so
+ * that the compressor's ballistics can smooth it directly. It is only
+ * rebuilt when the curve settings change; looking up a level is a clamp and
+ * a linear interpolation between two table entries regardless of the shape
+ * of the curve, so soft knees, expansion and gating cost the same as the
+ * original hard knee.
+ *
+ * Interpolation is exact on the straight sections of the curve. With
+ * entries h = 1/kStepsPerDecibel dB apart and s the change in slope across
+ * the knee (1 - 1/ratio for the compressor), it is out by at most
+ * s * h^2 / (8 * kneeWidth) dB inside a soft knee, and by at most s * h / 4
+ * dB (0.06dB for the compressor) around a hard knee whose threshold falls
+ * between two entries.
+ */
+class GainCurve
+{
+public:
+    //==============================================================================
+    enum CurveType
+    {
+        kCompressor = 0,    // Downward compression above the threshold
+        kUpwardCompressor,  // Upward compression below the threshold
+        kExpander,          // Downward expansion below the threshold
+        kGate,              // Fixed attenuation below the threshold
+        kCustom             // Curve supplied by setCustomCurve()
+    };
+
+    GainCurve();
+    ~GainCurve() {}
+
+    /** Rebuilds the table if any of the settings differ from the ones it was
+        last built with. Returns true if the table was rebuilt.
+     */
+    bool setParameters (
+        const CurveType type,
+        const float threshold,
+        const float ratio,
+        const float kneeWidth
+    ) noexcept;
+
+    /** Bakes an arbitrary static curve into the table. The function maps an
+        input level in dB to an output level in dB and is only called here,
+        never from getGainReduction().
+     */
+    void setCustomCurve (const std::function<float (float)>& transferFunction);
+
+    /** Returns the gain reduction in dB (input - output) for an input level
+        in dB.
+     */
+    inline float getGainReduction (const float inputLevel) const noexcept
+    {
+        // Clamping compiles to min/max instructions, so there is no branch on
+        // the level
+        const float position = (jlimit (kMinLevel, kMaxLevel, inputLevel) - kMinLevel) * kStepsPerDecibel;
+        const int index = (int) position;
+        const float fraction = position - index;
+        return table[index] + fraction * (table[index+1] - table[index]);
+    }
+
+    CurveType getType() const noexcept { return type; }
+    // Raw table, kStepsPerDecibel entries per dB from kMinLevel, for the
+    // vectorised gain computer in DSPKernels
+    const float* getTable() const noexcept { return table; }
+
+    // Range of input levels covered by the table, in dB. Levels outside the
+    // range are clamped to the nearest end.
+    static constexpr float kMinLevel = -120.0f;
+    static constexpr float kMaxLevel = 24.0f;
+    static constexpr float kStepsPerDecibel = 4.0f;
+    // Largest boost applied by the upward compressor, so that the noise floor
+    // isn't raised all the way to the threshold
+    static constexpr float kMaxUpwardGain = 24.0f;
+    // Attenuation applied by the gate below the threshold
+    static constexpr float kGateRange = 80.0f;
+
+private:
+    //==============================================================================
+    // Output level in dB of the built in curves for an input level in dB
+    float computeOutputLevel (const float inputLevel) const noexcept;
+
+    enum { kTableSize = (int) ((kMaxLevel - kMinLevel) * kStepsPerDecibel) + 1 };
+
+    // One extra entry so that interpolating at kMaxLevel stays in bounds
+    float table[kTableSize + 1];
+
+    CurveType type;
+    float threshold, ratio, kneeWidth;
+
+    JUCE_LEAK_DETECTOR (GainCurve);
+};
+
+#endif
@@ -0,0 +1,199 @@
+#include "LinearPhaseCrossover.h"
+#include <cmath>
+
+void LinearPhaseCrossover::prepare(const double sampleRate, const int numChannels, const int numBands)
+{
+    this->sampleRate = sampleRate;
+    this->numChannels = numChannels;
+    this->numBands = numBands;
+
+    // About 85ms of filter, rounded so the length is odd (a whole number of
+    // samples of group delay). With a Blackman window this gives a
+    // transition band of roughly 65Hz at 48kHz.
+    length = nextPowerOfTwo((int) (sampleRate * 0.085)) - 1;
+
+    // The window is only computed once per sample rate
+    window.allocate(length, false);
+    for(int n = 0; n < length; ++n) {
+        const double phase = 2.0 * double_Pi * n / (length - 1);
+        window[n] = (float) (0.42 - 0.5 * cos(phase) + 0.08 * cos(2.0 * phase));
+    }
+    lowPass.allocate(length, true);
+    previousLowPass.allocate(length, true);
+    bandResponse.allocate(length, true);
+    // Zero never matches a real frequency, so the first call to
+    // setCrossoverFrequencies() always asks for filters
+    const int numFrequencies = jmax(1, numBands - 1);
+    frequencies.allocate(numFrequencies, true);
+    requested.allocate(numFrequencies, true);
+    designFrequencies.allocate(numFrequencies, true);
+
+    for(auto& set : sets) {
+        set.kernels.resize(numBands);
+        for(auto& kernel : set.kernels) {
+            kernel = std::make_unique<ConvolutionKernel>();
+            kernel->prepare(length, kHeadSize, kTailSize);
+        }
+        set.request = -1;
+    }
+    convolvers.resize(numChannels * numBands);
+    for(auto& convolver : convolvers) {
+        convolver = std::make_unique<PartitionedConvolver>();
+        convolver->prepare(*sets[0].kernels[0]);
+    }
+
+    // Nothing is designed until designKernels() is called
+    current = -1;
+    fadingFrom = -1;
+    fadeRemaining = 0;
+    spareIndex = 1;
+    designedRequest = -1;
+    requestSequence.set(0);
+    handover.set(kSpareFree);
+
+    fadeLength = roundToInt(sampleRate * kFadeMs * 0.001);
+    latency = sets[0].kernels[0]->getLatency() + (length - 1) / 2;
+}
+
+void LinearPhaseCrossover::reset() noexcept
+{
+    // Resetting the convolvers ends their crossfades
+    for(auto& convolver : convolvers)
+        convolver->reset();
+    releaseFadingSet();
+}
+
+void LinearPhaseCrossover::releaseFadingSet() noexcept
+{
+    if(fadingFrom < 0)
+        return;
+    spareIndex = fadingFrom;
+    fadingFrom = -1;
+    handover.set(kSpareFree);
+}
+
+bool LinearPhaseCrossover::setCrossoverFrequencies(const float* newFrequencies) noexcept
+{
+    const float top = (float) (sampleRate * 0.49);
+    float previous = (float) kMinFrequency;
+    bool changed = false;
+    for(int i = 0; i < numBands - 1; ++i) {
+        const float frequency = jmin(top, jmax(previous, newFrequencies[i]));
+        changed |= (frequency != frequencies[i]);
+        frequencies[i] = frequency;
+        previous = frequency;
+    }
+    if(! changed)
+        return false;
+
+    ++requestSequence;
+    for(int i = 0; i < numBands - 1; ++i)
+        requested[i] = frequencies[i];
+    ++requestSequence;
+    return true;
+}
+
+bool LinearPhaseCrossover::beginSegment(const int numSamples) noexcept
+{
+    // The convolvers are done with the old set once they've processed
+    // getFadeLimit() samples since the crossfade started
+    if(fadingFrom >= 0 && fadeRemaining <= 0)
+        releaseFadingSet();
+
+    if(handover.get() == kSpareReady) {
+        const int ready = spareIndex;
+        if(current < 0) {
+            // Nothing to fade from
+            spareIndex = 1 - ready;
+            handover.set(kSpareFree);
+        }
+        else {
+            for(int channel = 0; channel < numChannels; ++channel)
+                for(int band = 0; band < numBands; ++band)
+                    convolvers[channel * numBands + band]->beginFade(*sets[current].kernels[band], fadeLength);
+            fadingFrom = current;
+            fadeRemaining = convolvers[0]->getFadeLimit(fadeLength);
+            handover.set(kSpareInUse);
+        }
+        current = ready;
+    }
+
+    if(fadingFrom >= 0)
+        fadeRemaining -= numSamples;
+
+    return handover.get() == kSpareFree
+        && (current < 0 || sets[current].request != requestSequence.get());
+}
+
+void LinearPhaseCrossover::designKernels() noexcept
+{
+    if(! handover.compareAndSetBool(kDesigning, kSpareFree))
+        return;
+
+    // The audio thread writes the request in a moment, so just try again if
+    // it was in the middle of it
+    int request;
+    for(;;) {
+        request = requestSequence.get();
+        if((request & 1) != 0)
+            continue;
+        for(int i = 0; i < numBands - 1; ++i)
+            designFrequencies[i] = requested[i];
+        if(requestSequence.get() == request)
+            break;
+    }
+    if(request == designedRequest) {
+        handover.set(kSpareFree);
+        return;
+    }
+
+    // Bands are differences of neighbouring low passes, so only one new
+    // low pass needs designing for each band
+    KernelSet& set = sets[spareIndex];
+    FloatVectorOperations::clear(previousLowPass, length);
+    for(int band = 0; band < numBands; ++band) {
+        if(band < numBands - 1) {
+            designLowPass(lowPass, designFrequencies[band]);
+        } else {
+            // The top band is everything above the last crossover: an
+            // impulse at the centre of the filter minus the last low pass
+            FloatVectorOperations::clear(lowPass, length);
+            lowPass[(length - 1) / 2] = 1.0f;
+        }
+        for(int n = 0; n < length; ++n)
+            bandResponse[n] = lowPass[n] - previousLowPass[n];
+        set.kernels[band]->setImpulseResponse(bandResponse, length);
+        FloatVectorOperations::copy(previousLowPass, lowPass, length);
+    }
+    set.request = request;
+    designedRequest = request;
+    handover.set(kSpareReady);
+}
+
+void LinearPhaseCrossover::designLowPass(float* impulseResponse, const float frequency) const noexcept
+{
+    // Normalised cutoff, kept just below Nyquist
+    const double fc = jmin((double) frequency / sampleRate, 0.49);
+    const int centre = (length - 1) / 2;
+    double sum = 0;
+    for(int n = 0; n < length; ++n) {
+        const double x = 2.0 * double_Pi * fc * (n - centre);
+        const double sinc = (n == centre) ? 2.0 * fc : sin(x) / (double_Pi * (n - centre));
+        impulseResponse[n] = (float) (sinc * window[n]);
+        sum += impulseResponse[n];
+    }
+    // Scale for exactly unity gain at DC so the low band passes bass
+    // without ripple
+    FloatVectorOperations::multiply(impulseResponse, (float) (1.0 / sum), length);
+}
+
+size_t LinearPhaseCrossover::getMemoryUsage() const noexcept
+{
+    size_t bytes = sizeof(float) * (size_t) (length * 4 + jmax(1, numBands - 1) * 3);
+    for(auto& set : sets)
+        for(auto& kernel : set.kernels)
+            bytes += kernel->getMemoryUsage();
+    for(auto& convolver : convolvers)
+        bytes += convolver->getMemoryUsage();
+    return bytes;
+}
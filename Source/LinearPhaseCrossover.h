@@ -0,0 +1,142 @@
+#ifndef __LINEARPHASECROSSOVER_H__
+#define __LINEARPHASECROSSOVER_H__
+
+#include "JuceHeader.h"
+#include "PartitionedConvolver.h"
+#include <vector>
+#include <memory>
+
+//==============================================================================
+/**
+ * Linear-phase alternative to the Linkwitz-Riley crossover bank.
+ *
+ * Each band is a symmetric FIR filter built from windowed-sinc low passes:
+ * the lowest band is the first low pass, each middle band the difference of
+ * two neighbouring low passes and the highest band a delayed impulse minus
+ * the last low pass. The bands therefore sum back to a pure delay, with no
+ * phase shift at the crossover points.
+ *
+ * Filters are run with non-uniformly partitioned FFT convolution. The
+ * impulse response of each band is shared by every channel; each channel
+ * and band has its own convolver state. Everything is allocated in
+ * prepare().
+ *
+ * Designing the filters takes far longer than a block, so it isn't done on
+ * the audio thread. There are two sets of filters: the audio thread runs one
+ * while designKernels() fills the other and hands it over (wait-free,
+ * through the handover state). The audio thread then crossfades every
+ * convolver from the old set to the new one and gives the old set back once
+ * the crossfade is over.
+ */
+class LinearPhaseCrossover
+{
+public:
+    LinearPhaseCrossover() {}
+    ~LinearPhaseCrossover() {}
+
+    void prepare (const double sampleRate, const int numChannels, const int numBands);
+    void reset() noexcept;
+
+    // Audio thread: asks for band filters for the numBands-1 frequencies (in
+    // Hz). They're kept within the audible range below Nyquist and in
+    // ascending order: a frequency below the one before it is raised to it,
+    // leaving the band between them empty. Returns true if they differ from
+    // the last ones asked for.
+    bool setCrossoverFrequencies (const float* frequencies) noexcept;
+
+    // Designs filters for the frequencies last asked for into the set the
+    // audio thread isn't running, and hands them over. Call it from any
+    // thread, including the audio thread while rendering offline; it does
+    // nothing if the set is still in use or already up to date.
+    void designKernels() noexcept;
+
+    // Audio thread, before the bands of each segment: starts a crossfade to
+    // filters that have been handed over, and gives the old ones back once
+    // it's over. Returns true if designKernels() should be called.
+    bool beginSegment (const int numSamples) noexcept;
+
+    // Filter one channel into one band. in and out may be the same. Silent
+    // until the first filters have been designed.
+    void processBand (const int channel, const int band, const float* in, float* out, const int numSamples) noexcept
+    {
+        processBandMix (channel, band, in, in, 1.0f, 0.0f, out, numSamples);
+    }
+    // Clears one channel's filter for one band
+    void resetBand (const int channel, const int band) noexcept
+    {
+        convolvers[channel * numBands + band]->reset();
+    }
+    // Filter gainA * inA + gainB * inB into one band, e.g. the mid or side
+    // of a stereo pair
+    void processBandMix (const int channel, const int band, const float* inA, const float* inB,
+                         const float gainA, const float gainB, float* out, const int numSamples) noexcept
+    {
+        if (current < 0)
+            FloatVectorOperations::clear (out, numSamples);
+        else
+            convolvers[channel * numBands + band]->process (*sets[current].kernels[band], inA, inB, gainA, gainB, out, numSamples);
+    }
+
+    // Total delay of every band, in samples: the delay of the convolution
+    // plus the group delay of the filters
+    int getLatency() const noexcept { return latency; }
+
+    // Bytes allocated by prepare()
+    size_t getMemoryUsage() const noexcept;
+
+    // Partition sizes of the convolution. The head sets the block delay;
+    // the tail does most of the work.
+    enum { kHeadSize = 64, kTailSize = 1024 };
+
+    // Length of the crossfade between old and new filters
+    enum { kFadeMs = 20, kMinFrequency = 20 };
+
+private:
+    // Where the set the audio thread isn't running is
+    enum { kSpareFree, kDesigning, kSpareReady, kSpareInUse };
+
+    // Filters for every band, and the request they were designed for
+    struct KernelSet
+    {
+        std::vector<std::unique_ptr<ConvolutionKernel>> kernels;   // One per band
+        int request = -1;
+    };
+
+    // Windowed-sinc low pass with unity gain at DC
+    void designLowPass (float* impulseResponse, const float frequency) const noexcept;
+    void releaseFadingSet() noexcept;
+
+    KernelSet sets[2];
+    std::vector<std::unique_ptr<PartitionedConvolver>> convolvers; // Channel by channel
+    HeapBlock<float> window;
+    double sampleRate = 44100.0;
+    int numChannels = 0, numBands = 0;
+    int length = 0;
+    int latency = 0;
+    int fadeLength = 0;
+
+    // Audio thread: the set being run, the one being faded from (or -1) and
+    // the samples left before the convolvers are done with it
+    int current = -1, fadingFrom = -1;
+    int fadeRemaining = 0;
+    HeapBlock<float> frequencies;   // Last asked for
+
+    // The request, written by the audio thread. requestSequence is odd
+    // while it's being written.
+    Atomic<int> requestSequence;
+    HeapBlock<float> requested;
+
+    // handover says who has the spare set: the audio thread writes
+    // spareIndex before giving it back
+    Atomic<int> handover;
+    int spareIndex = 1;
+
+    // Only touched by designKernels(), while it has the spare set
+    HeapBlock<float> designFrequencies;
+    HeapBlock<float> lowPass, previousLowPass, bandResponse;
+    int designedRequest = -1;
+
+    JUCE_LEAK_DETECTOR (LinearPhaseCrossover);
+};
+
+#endif
@@ -0,0 +1,245 @@
+#include "LoudnessMeter.h"
+
+LoudnessMeter::LoudnessMeter()
+{
+    for(int i = 0; i < 5; ++i)
+        shelfCoefficients[i] = highPassCoefficients[i] = 0;
+    reset();
+}
+
+void LoudnessMeter::prepare(const double sampleRate, const int numChannels)
+{
+    maxChannels = jlimit(0, (int) kMaxChannels, numChannels);
+    channels.allocate(jmax(1, maxChannels), true);
+    for(int ch = 0; ch < maxChannels; ++ch)
+        channels[ch].weight = 1.0f;
+    stepSize = jmax(1, roundToInt(sampleRate * 0.1));
+
+    // K-weighting, designed for any sample rate from the analogue
+    // prototypes of BS.1770's 48kHz coefficients. Stage 1 is a +4dB high
+    // shelf modelling the head...
+    {
+        const double f0 = 1681.974450955533, gain = 3.999843853973347, q = 0.7071752369554196;
+        const double k = std::tan(double_Pi * f0 / sampleRate);
+        const double vh = std::pow(10.0, gain / 20.0);
+        const double vb = std::pow(vh, 0.4996667741545416);
+        const double a0 = 1.0 + k / q + k * k;
+        shelfCoefficients[0] = (vh + vb * k / q + k * k) / a0;
+        shelfCoefficients[1] = 2.0 * (k * k - vh) / a0;
+        shelfCoefficients[2] = (vh - vb * k / q + k * k) / a0;
+        shelfCoefficients[3] = 2.0 * (k * k - 1.0) / a0;
+        shelfCoefficients[4] = (1.0 - k / q + k * k) / a0;
+    }
+    // ...and stage 2 the RLB high-pass
+    {
+        const double f0 = 38.13547087602444, q = 0.5003270373238773;
+        const double k = std::tan(double_Pi * f0 / sampleRate);
+        const double a0 = 1.0 + k / q + k * k;
+        highPassCoefficients[0] = 1.0;
+        highPassCoefficients[1] = -2.0;
+        highPassCoefficients[2] = 1.0;
+        highPassCoefficients[3] = 2.0 * (k * k - 1.0) / a0;
+        highPassCoefficients[4] = (1.0 - k / q + k * k) / a0;
+    }
+
+    // True peak interpolator (see TruePeakDetector)
+    oversampling = TruePeakDetector::getOversampling(sampleRate);
+    TruePeakDetector::designInterpolator(interpolator, oversampling);
+
+    reset();
+}
+
+void LoudnessMeter::setChannelLayout(const AudioChannelSet& layout)
+{
+    for(int ch = 0; ch < jmin(maxChannels, layout.size()); ++ch) {
+        switch(layout.getTypeOfChannel(ch)) {
+            case AudioChannelSet::LFE:
+            case AudioChannelSet::LFE2:
+                channels[ch].weight = 0.0f;
+                break;
+            case AudioChannelSet::leftSurround:
+            case AudioChannelSet::rightSurround:
+            case AudioChannelSet::leftSurroundSide:
+            case AudioChannelSet::rightSurroundSide:
+                channels[ch].weight = 1.41f;
+                break;
+            default:
+                channels[ch].weight = 1.0f;
+                break;
+        }
+    }
+}
+
+void LoudnessMeter::setChannelWeight(const int channel, const float weight) noexcept
+{
+    if(isPositiveAndBelow(channel, maxChannels))
+        channels[channel].weight = weight;
+}
+
+void LoudnessMeter::reset() noexcept
+{
+    for(int ch = 0; ch < maxChannels; ++ch) {
+        ChannelState& state = channels[ch];
+        state.shelf[0] = state.shelf[1] = 0;
+        state.highPass[0] = state.highPass[1] = 0;
+        for(int i = 0; i < kTapsPerPhase * 2; ++i)
+            state.history[i] = 0;
+        state.historyPosition = 0;
+    }
+    stepFill = 0;
+    stepEnergy = 0;
+    for(int i = 0; i < kShortTermSteps; ++i)
+        steps[i] = 0;
+    stepPosition = 0;
+    numSteps = 0;
+    for(int i = 0; i < kHistogramBins; ++i) {
+        histogramEnergy[i] = 0;
+        histogramCount[i] = 0;
+    }
+    peak = 0;
+    momentary.set((float) kFloor);
+    shortTerm.set((float) kFloor);
+    integrated.set((float) kFloor);
+    truePeak.set(0.0f);
+}
+
+void LoudnessMeter::process(const float* const* input, const int numChannels, const int numSamples) noexcept
+{
+    if(resetRequested.get() != 0) {
+        reset();
+        resetRequested.set(0);
+    }
+    const int numMeasured = jmin(numChannels, maxChannels);
+    const double* s = shelfCoefficients;
+    const double* h = highPassCoefficients;
+
+    // Work up to the end of each 100ms step at a time
+    for(int start = 0; start < numSamples;) {
+        const int count = jmin(numSamples - start, stepSize - stepFill);
+        for(int ch = 0; ch < numMeasured; ++ch) {
+            ChannelState& state = channels[ch];
+            const float* x = input[ch] + start;
+            double shelf0 = state.shelf[0], shelf1 = state.shelf[1];
+            double highPass0 = state.highPass[0], highPass1 = state.highPass[1];
+            int position = state.historyPosition;
+            float channelPeak = peak;
+            double energy = 0;
+            for(int i = 0; i < count; ++i) {
+                // The history is stored twice over so that the taps can be
+                // read without wrapping
+                if(--position < 0)
+                    position += kTapsPerPhase;
+                state.history[position] = state.history[position + kTapsPerPhase] = x[i];
+                const float* history = state.history + position;
+                for(int phase = 0; phase < oversampling; ++phase) {
+                    float y = 0;
+                    for(int tap = 0; tap < kTapsPerPhase; ++tap)
+                        y += interpolator[phase][tap] * history[tap];
+                    channelPeak = jmax(channelPeak, std::abs(y));
+                }
+
+                const double in = x[i];
+                const double shelved = s[0] * in + shelf0;
+                shelf0 = s[1] * in - s[3] * shelved + shelf1;
+                shelf1 = s[2] * in - s[4] * shelved;
+                const double weighted = h[0] * shelved + highPass0;
+                highPass0 = h[1] * shelved - h[3] * weighted + highPass1;
+                highPass1 = h[2] * shelved - h[4] * weighted;
+                energy += weighted * weighted;
+            }
+            state.shelf[0] = shelf0;
+            state.shelf[1] = shelf1;
+            state.highPass[0] = highPass0;
+            state.highPass[1] = highPass1;
+            state.historyPosition = position;
+            peak = channelPeak;
+            stepEnergy += state.weight * energy;
+        }
+        start += count;
+        stepFill += count;
+        if(stepFill == stepSize)
+            endStep();
+    }
+    truePeak.set(peak);
+}
+
+void LoudnessMeter::endStep() noexcept
+{
+    steps[stepPosition] = stepEnergy / stepSize;
+    stepPosition = (stepPosition + 1) % kShortTermSteps;
+    ++numSteps;
+    stepEnergy = 0;
+    stepFill = 0;
+
+    if(numSteps >= kShortTermSteps) {
+        double energy = 0;
+        for(int i = 0; i < kShortTermSteps; ++i)
+            energy += steps[i];
+        shortTerm.set(toLoudness(energy / kShortTermSteps));
+    }
+    if(numSteps < kMomentarySteps)
+        return;
+
+    double energy = 0;
+    for(int i = 1; i <= kMomentarySteps; ++i)
+        energy += steps[(stepPosition + kShortTermSteps - i) % kShortTermSteps];
+    energy /= kMomentarySteps;
+    const float loudness = toLoudness(energy);
+    momentary.set(loudness);
+
+    // The momentary block doubles as a gating block (400ms, 75% overlap)
+    if(numSteps * stepSize > numSkipped && loudness >= -70.0f) {
+        const int bin = jlimit(0, (int) kHistogramBins - 1, (int) ((loudness + 70.0f) * 10.0f));
+        histogramEnergy[bin] += energy;
+        ++histogramCount[bin];
+        updateIntegrated();
+    }
+}
+
+// Gated mean of the blocks in the histogram: the absolute gate is applied
+// as blocks are added, and the relative gate is 10 LU below the mean of
+// everything above the absolute gate
+void LoudnessMeter::updateIntegrated() noexcept
+{
+    double energy = 0;
+    int64 count = 0;
+    for(int i = 0; i < kHistogramBins; ++i) {
+        energy += histogramEnergy[i];
+        count += histogramCount[i];
+    }
+    if(count == 0) {
+        integrated.set((float) kFloor);
+        return;
+    }
+    const float relativeGate = toLoudness(energy / count) - 10.0f;
+    const int firstBin = jlimit(0, (int) kHistogramBins, (int) std::floor((relativeGate + 70.0f) * 10.0f));
+    energy = 0;
+    count = 0;
+    for(int i = firstBin; i < kHistogramBins; ++i) {
+        energy += histogramEnergy[i];
+        count += histogramCount[i];
+    }
+    integrated.set(count > 0 ? toLoudness(energy / count) : (float) kFloor);
+}
+
+void LoudnessMeter::merge(const LoudnessMeter& other) noexcept
+{
+    for(int i = 0; i < kHistogramBins; ++i) {
+        histogramEnergy[i] += other.histogramEnergy[i];
+        histogramCount[i] += other.histogramCount[i];
+    }
+    peak = jmax(peak, other.peak);
+    truePeak.set(peak);
+    updateIntegrated();
+}
+
+float LoudnessMeter::getTruePeak() const noexcept
+{
+    const float p = truePeak.get();
+    return p > 0 ? jmax((float) kFloor, 20.0f * std::log10(p)) : (float) kFloor;
+}
+
+float LoudnessMeter::toLoudness(const double energy) noexcept
+{
+    return energy > 0 ? jmax((float) kFloor, (float) (-0.691 + 10.0 * std::log10(energy))) : (float) kFloor;
+}
@@ -0,0 +1,125 @@
+#ifndef __LOUDNESSMETER_H__
+#define __LOUDNESSMETER_H__
+
+#include "JuceHeader.h"
+#include "TruePeakDetector.h"
+
+//==============================================================================
+/**
+ * Streaming loudness and true-peak meter following ITU-R BS.1770.
+ *
+ * Every channel is K-weighted (high shelf then RLB high-pass) and the
+ * weighted mean square of all channels is summed in 100ms steps. Momentary
+ * (400ms) and short-term (3s) loudness come from a ring of the last 30
+ * steps. Each momentary block is also a gating block for the integrated
+ * loudness: blocks above the -70 LUFS absolute gate go into a histogram of
+ * 0.1 LU bins holding their count and total energy, from which the relative
+ * gate (-10 LU) and the gated mean are found exactly to within a bin. So
+ * memory doesn't grow with the length of the programme, and measurements
+ * from separate parts of one programme can be merged.
+ *
+ * True peak is measured by 4x oversampling (2x from 96kHz, none from
+ * 192kHz) with TruePeakDetector's windowed sinc interpolator, run here in
+ * the same pass as the K-weighting.
+ *
+ * All memory is allocated in prepare(). process() is meant for the audio
+ * thread; the readings can be taken from any thread.
+ */
+class LoudnessMeter
+{
+public:
+    LoudnessMeter();
+    ~LoudnessMeter() {}
+
+    enum
+    {
+        kMaxChannels = 64,
+        kFloor = -120       // Reading when there's nothing to measure
+    };
+
+    void prepare (const double sampleRate, const int numChannels);
+    // Sets the channel weights from the speaker positions of a layout:
+    // surrounds count 1.41 times, LFEs not at all and the rest once
+    void setChannelLayout (const AudioChannelSet& layout);
+    void setChannelWeight (const int channel, const float weight) noexcept;
+
+    // Measures numSamples of the first numChannels channels
+    void process (const float* const* channels, const int numChannels, const int numSamples) noexcept;
+
+    // Leaves gating blocks that end within the first numSamples measured out
+    // of the integrated loudness, e.g. while the signal is warming up
+    void skipSamples (const int64 numSamples) noexcept { numSkipped = numSamples; }
+
+    // Adds the gating blocks and true peak measured by another meter at the
+    // same sample rate, for a programme measured in parts. Not for the audio
+    // thread.
+    void merge (const LoudnessMeter& other) noexcept;
+
+    // Clears the readings. Safe to call from any thread; the audio thread
+    // does the clearing at the start of the next process().
+    void requestReset() noexcept { resetRequested.set (1); }
+
+    // Readings in LUFS (and dBTP for the true peak). Safe to call from any
+    // thread.
+    float getMomentaryLoudness() const noexcept { return momentary.get(); }
+    float getShortTermLoudness() const noexcept { return shortTerm.get(); }
+    float getIntegratedLoudness() const noexcept { return integrated.get(); }
+    float getTruePeak() const noexcept;
+
+    // Samples per 100ms step
+    int getStepSize() const noexcept { return stepSize; }
+
+    // Bytes allocated by prepare()
+    size_t getMemoryUsage() const noexcept { return sizeof (ChannelState) * (size_t) jmax (1, maxChannels); }
+
+private:
+    enum
+    {
+        kMomentarySteps = 4,
+        kShortTermSteps = 30,
+        kHistogramBins = 1000,      // 0.1 LU bins from the absolute gate up
+        kTapsPerPhase = TruePeakDetector::kTapsPerPhase,
+        kMaxOversampling = TruePeakDetector::kMaxOversampling
+    };
+
+    struct ChannelState
+    {
+        double shelf[2], highPass[2];   // K-weighting, transposed direct form II
+        float history[kTapsPerPhase * 2];
+        int historyPosition;
+        float weight;
+    };
+
+    void reset() noexcept;
+    void endStep() noexcept;
+    void updateIntegrated() noexcept;
+    static float toLoudness (const double energy) noexcept;
+
+    HeapBlock<ChannelState> channels;
+    int maxChannels = 0;
+
+    // K-weighting coefficients (b0, b1, b2, a1, a2) for each stage
+    double shelfCoefficients[5], highPassCoefficients[5];
+
+    // Interpolator, one set of taps per output phase
+    float interpolator[kMaxOversampling][kTapsPerPhase];
+    int oversampling = 1;
+
+    int stepSize = 0, stepFill = 0;
+    double stepEnergy = 0;
+    double steps[kShortTermSteps];
+    int stepPosition = 0;
+    int64 numSteps = 0;
+    int64 numSkipped = 0;
+
+    double histogramEnergy[kHistogramBins];
+    int64 histogramCount[kHistogramBins];
+    float peak = 0;
+
+    Atomic<int> resetRequested;
+    Atomic<float> momentary, shortTerm, integrated, truePeak;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LoudnessMeter);
+};
+
+#endif
@@ -0,0 +1,133 @@
+#include "OfflineRenderer.h"
+
+OfflineRenderer::OfflineRenderer(Assignment1Processor& s)
+    : settings(s), tolerance(1.0e-5)
+{
+}
+
+// A fresh instance with the same parameters as the one being rendered
+Assignment1Processor* OfflineRenderer::createProcessor(const double sampleRate) const
+{
+    Assignment1Processor* processor = new Assignment1Processor();
+    for(int i = 0; i < settings.getNumParameters(); ++i)
+        processor->setParameter(i, settings.getParameter(i));
+    processor->setNonRealtime(true);
+    processor->setPlayConfigDetails(numChannels, numChannels, sampleRate, blockSize);
+    processor->prepareToPlay(sampleRate, blockSize);
+    return processor;
+}
+
+void OfflineRenderer::render(const AudioSampleBuffer& input, AudioSampleBuffer& output,
+                             const double sampleRate, const int newBlockSize, int numChunks)
+{
+    numChannels = input.getNumChannels();
+    numSamples = input.getNumSamples();
+    blockSize = newBlockSize;
+    output.setSize(numChannels, numSamples, false, false, true);
+    if(numSamples == 0 || numChannels == 0 || blockSize <= 0)
+        return;
+
+    // The first instance tells us how far back each chunk has to start
+    chunks.clear();
+    chunks.push_back(std::unique_ptr<Chunk>(new Chunk()));
+    chunks[0]->processor.reset(createProcessor(sampleRate));
+    warmUpSamples = chunks[0]->processor->getWarmUpSamples(tolerance);
+    alignment = chunks[0]->processor->getChunkAlignment(blockSize);
+    latency = chunks[0]->processor->getLatencySamples();
+
+    // Chunks have to join on the meter's 100ms grid for their gating blocks
+    // to be the same as those of a single meter, and have to be pre-rolled
+    // for at least as long as their meters are
+    loudness.prepare(sampleRate, numChannels);
+    const int stepSize = loudness.getStepSize();
+    if(measureLoudness)
+        warmUpSamples = jmax(warmUpSamples, (int) kMeterLeadSteps * stepSize);
+
+    if(numChunks <= 0)
+        numChunks = threadPool->getNumWorkers() + 1;
+    numChunks = jlimit(1, jmax(1, numSamples / jmax(1, warmUpSamples * kMinChunkLength)), numChunks);
+
+    for(int i = 1; i < numChunks; ++i) {
+        chunks.push_back(std::unique_ptr<Chunk>(new Chunk()));
+        chunks[i]->processor.reset(createProcessor(sampleRate));
+    }
+    for(int i = 0; i < numChunks; ++i) {
+        Chunk& chunk = *chunks[i];
+        chunk.block.setSize(numChannels, blockSize);
+        chunk.start = (int) ((int64) numSamples * i / numChunks);
+        chunk.start -= chunk.start % stepSize;
+        chunk.end = (int) ((int64) numSamples * (i + 1) / numChunks);
+        if(i < numChunks - 1)
+            chunk.end -= chunk.end % stepSize;
+        if(measureLoudness) {
+            chunk.meter.prepare(sampleRate, numChannels);
+            chunk.meterStart = jmax(0, chunk.start - kMeterLeadSteps * stepSize);
+            chunk.meter.skipSamples(chunk.start - chunk.meterStart);
+            chunk.meterChannels.resize(numChannels);
+        }
+    }
+
+    // Take the channel pointers here so that the chunks only ever touch the
+    // samples, each in its own range of the output
+    inputChannels.resize(numChannels);
+    outputChannels.resize(numChannels);
+    for(int ch = 0; ch < numChannels; ++ch) {
+        inputChannels[ch] = input.getReadPointer(ch);
+        outputChannels[ch] = output.getWritePointer(ch);
+    }
+
+    threadPool->run(&OfflineRenderer::renderChunkJob, this, numChunks);
+
+    for(int i = 0; i < numChunks && measureLoudness; ++i)
+        loudness.merge(chunks[i]->meter);
+    chunks.clear();
+}
+
+void OfflineRenderer::renderChunkJob(void* context, int chunkIndex)
+{
+    static_cast<OfflineRenderer*>(context)->renderChunk(chunkIndex);
+}
+
+void OfflineRenderer::renderChunk(const int chunkIndex)
+{
+    Chunk& chunk = *chunks[chunkIndex];
+
+    // Pre-roll from the start of the block the warm-up begins in. The
+    // output for input sample n comes out latency samples later.
+    int position = jmax(0, chunk.start - warmUpSamples);
+    position -= position % alignment;
+    const int end = chunk.end + latency;
+
+    for(; position < end; position += blockSize) {
+        // Always process whole blocks, running past the end of the input
+        // with silence, so that they line up with those of an
+        // uninterrupted render
+        const int numInput = jlimit(0, blockSize, numSamples - position);
+        for(int ch = 0; ch < numChannels; ++ch) {
+            float* block = chunk.block.getWritePointer(ch);
+            FloatVectorOperations::copy(block, inputChannels[ch] + position, numInput);
+            FloatVectorOperations::clear(block + numInput, blockSize - numInput);
+        }
+
+        chunk.processor->processBlock(chunk.block, chunk.midi);
+
+        // Keep whatever falls inside this chunk once the latency is removed
+        const int first = jmax(position, chunk.start + latency);
+        const int last = jmin(position + blockSize, end);
+        if(last > first) {
+            for(int ch = 0; ch < numChannels; ++ch)
+                FloatVectorOperations::copy(outputChannels[ch] + first - latency,
+                                            chunk.block.getReadPointer(ch, first - position), last - first);
+        }
+
+        // The meter starts a little earlier, on the end of the pre-roll
+        if(measureLoudness) {
+            const int firstMeasured = jmax(position, chunk.meterStart + latency);
+            if(last > firstMeasured) {
+                for(int ch = 0; ch < numChannels; ++ch)
+                    chunk.meterChannels[ch] = chunk.block.getReadPointer(ch, firstMeasured - position);
+                chunk.meter.process(chunk.meterChannels.data(), numChannels, last - firstMeasured);
+            }
+        }
+    }
+}
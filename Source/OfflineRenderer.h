@@ -0,0 +1,99 @@
+#ifndef __OFFLINERENDERER_H__
+#define __OFFLINERENDERER_H__
+
+#include "JuceHeader.h"
+#include "PluginProcessor.h"
+#include <vector>
+#include <memory>
+
+//==============================================================================
+/**
+ * Renders a long file through the plugin on every core at once.
+ *
+ * The file is cut into one chunk per core and each chunk is processed by its
+ * own Assignment1Processor, set up with the parameters of the one passed
+ * in. Before its chunk starts, each instance is pre-rolled on the audio
+ * leading up to it (see Assignment1Processor::getWarmUpSamples) so that its
+ * filters and compressors are in the state an uninterrupted render would
+ * have reached, to within a set tolerance. Pre-rolls start on the same
+ * block (and STFT frame) grid as an uninterrupted render, so the chunks
+ * join up without audible seams.
+ *
+ * The only extra work is the pre-roll of each chunk, so the speed-up is
+ * close to the number of cores as long as the file is much longer than
+ * the pre-roll times the number of cores.
+ *
+ * The output is compensated for the plugin's latency. Automation isn't
+ * rendered: the settings are those at the time of the call.
+ *
+ * The loudness and true peak of the output are measured as it is rendered,
+ * each chunk with its own LoudnessMeter (counting only the gating blocks
+ * that end inside it), and merged at the end, so the result can be
+ * normalised without another pass over the file.
+ */
+class OfflineRenderer
+{
+public:
+    OfflineRenderer (Assignment1Processor& settings);
+    ~OfflineRenderer() {}
+
+    // Fraction of any difference in filter and compressor state that may be
+    // left at the start of each chunk. 1e-5 (-100dB) by default.
+    void setTolerance (const double newTolerance) { tolerance = newTolerance; }
+
+    // Whether render() measures the loudness of its output. On by default.
+    void setMeasureLoudness (const bool shouldMeasure) { measureLoudness = shouldMeasure; }
+    // Integrated loudness and true peak of the last render. Channels are
+    // weighted equally, as the file has no speaker layout.
+    const LoudnessMeter& getLoudness() const { return loudness; }
+
+    // Renders input into output (resized to match), blockSize samples at a
+    // time. numChunks of 0 uses one chunk per core, and 1 renders serially.
+    // Fewer chunks are used if the file is too short for them to pay for
+    // their pre-roll. Blocks until the render has finished.
+    void render (const AudioSampleBuffer& input, AudioSampleBuffer& output,
+                 const double sampleRate, const int blockSize, int numChunks = 0);
+
+private:
+    struct Chunk
+    {
+        std::unique_ptr<Assignment1Processor> processor;
+        AudioSampleBuffer block;
+        MidiBuffer midi;
+        int start, end;     // Output samples this chunk produces
+        LoudnessMeter meter;
+        int meterStart;     // First output sample measured
+        std::vector<const float*> meterChannels;
+    };
+
+    Assignment1Processor* createProcessor (const double sampleRate) const;
+    static void renderChunkJob (void* context, int chunkIndex);
+    void renderChunk (const int chunkIndex);
+
+    // Shortest chunk, in pre-rolls, so that pre-rolling costs at most a
+    // quarter of the render. The meter of each chunk starts four 100ms steps
+    // early: three for the gating blocks that overlap the start of the
+    // chunk, and one for the K-weighting filters to settle.
+    enum
+    {
+        kMinChunkLength = 4,
+        kMeterLeadSteps = 4
+    };
+
+    Assignment1Processor& settings;
+    double tolerance;
+    bool measureLoudness = true;
+    LoudnessMeter loudness;
+
+    // Set up by render() for the chunks
+    std::vector<std::unique_ptr<Chunk>> chunks;
+    std::vector<const float*> inputChannels;
+    std::vector<float*> outputChannels;
+    int numChannels = 0, numSamples = 0, blockSize = 0;
+    int warmUpSamples = 0, alignment = 1, latency = 0;
+    SharedResourcePointer<DSPThreadPool> threadPool;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (OfflineRenderer);
+};
+
+#endif
@@ -0,0 +1,88 @@
+#ifndef __PARAMETERCHANGEQUEUE_H__
+#define __PARAMETERCHANGEQUEUE_H__
+
+#include "JuceHeader.h"
+
+//==============================================================================
+/**
+ * Lock-free queue of the indices of parameters that have changed since the
+ * editor last looked.
+ *
+ * Any number of threads can push (the host's automation thread, the audio
+ * thread applying queued automation, the editor itself); one thread pops.
+ * A parameter that is already waiting isn't queued again, so however many
+ * times it changes between two pops it comes out once, and the queue never
+ * needs more than one slot per parameter - it can't overflow.
+ */
+class ParameterChangeQueue
+{
+public:
+    ParameterChangeQueue() {}
+    ~ParameterChangeQueue() {}
+
+    // Allocates room for numParameters parameters. Call before anything is
+    // pushed, e.g. at the end of the processor's constructor.
+    void prepare (const int numParameters)
+    {
+        size = numParameters;
+        mask = 1;
+        while (mask < jmax (1, numParameters))
+            mask <<= 1;
+        pending.allocate ((size_t) size + 1, true);
+        slots.allocate ((size_t) mask, true);
+        mask -= 1;
+        head.set (0);
+        tail = 0;
+    }
+
+    // Marks a parameter as changed. Wait-free, safe from any thread.
+    void push (const int parameterIndex) noexcept
+    {
+        if (! isPositiveAndBelow (parameterIndex, size)
+             || ! pending[parameterIndex].compareAndSetBool (1, 0))
+            return;
+        const int position = ++head - 1;
+        slots[position & mask].set (parameterIndex + 1);
+    }
+
+    // Copies up to maxIndices changed parameters into dest, each once, and
+    // returns how many were copied. Read the parameters' values after this
+    // returns: a change made after its index was popped queues it again.
+    int pop (int* dest, const int maxIndices) noexcept
+    {
+        int numPopped = 0;
+        while (numPopped < maxIndices)
+        {
+            // A push that has claimed this slot but not filled it yet is
+            // picked up next time
+            Atomic<int>& slot = slots[tail & mask];
+            const int value = slot.get();
+            if (value == 0)
+                break;
+            slot.set (0);
+            ++tail;
+            pending[value - 1].set (0);
+            dest[numPopped++] = value - 1;
+        }
+        return numPopped;
+    }
+
+    int getNumParameters() const noexcept { return size; }
+
+    // Bytes allocated by prepare()
+    size_t getMemoryUsage() const noexcept
+    {
+        return sizeof (Atomic<int>) * (size > 0 ? (size_t) size + 1 + (size_t) mask + 1 : 0);
+    }
+
+private:
+    HeapBlock<Atomic<int> > pending;    // Per parameter: queued and not yet popped
+    HeapBlock<Atomic<int> > slots;      // Parameter index + 1, or 0 when empty
+    Atomic<int> head;                   // Next slot to claim (pushers)
+    int tail = 0;                       // Next slot to read (popper)
+    int size = 0, mask = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ParameterChangeQueue);
+};
+
+#endif
@@ -0,0 +1,366 @@
+#include "PartitionedConvolver.h"
+
+namespace
+{
+    // FFT order of a transform twice the size of a partition
+    int getFFTOrder(const int partitionSize)
+    {
+        int order = 0;
+        while((1 << order) < partitionSize * 2)
+            ++order;
+        return order;
+    }
+}
+
+//==============================================================================
+void ConvolutionKernel::prepare(const int maxLength, const int headSize, const int tailSize)
+{
+    jassert (isPowerOfTwo(headSize) && isPowerOfTwo(tailSize) && tailSize > headSize);
+    // The head covers the taps before the tail's first partition; the tail
+    // covers everything else. A tail starting at tailSize - headSize would
+    // line its block delay up with the head's; one more partition gives the
+    // convolver that long to work each tail block out.
+    const int headTaps = tailSize * 2 - headSize;
+    prepareSection(head, headSize, 0, jmin(maxLength, headTaps));
+    prepareSection(tail, tailSize, headTaps, jmax(0, maxLength - headTaps));
+}
+
+void ConvolutionKernel::prepareSection(Section& section, const int partitionSize, const int firstTap, const int maxTaps)
+{
+    const int fftSize = partitionSize * 2;
+    section.partitionSize = partitionSize;
+    section.numBins = partitionSize + 1;
+    section.firstTap = firstTap;
+    section.maxPartitions = (maxTaps + partitionSize - 1) / partitionSize;
+    section.numPartitions = 0;
+    section.spectra.allocate(jmax(1, section.maxPartitions * section.numBins), true);
+    section.timeScratch.allocate(fftSize, true);
+    section.freqScratch.allocate(fftSize, true);
+    section.forward.reset(new FFT(getFFTOrder(partitionSize), false));
+    section.inverse.reset(new FFT(getFFTOrder(partitionSize), true));
+}
+
+void ConvolutionKernel::setImpulseResponse(const float* impulseResponse, const int length) noexcept
+{
+    loadSection(head, impulseResponse, length);
+    loadSection(tail, impulseResponse, length);
+}
+
+void ConvolutionKernel::loadSection(Section& section, const float* impulseResponse, const int length) noexcept
+{
+    const int B = section.partitionSize;
+    const int fftSize = B * 2;
+    // The inverse transform isn't normalised, so the scaling is folded into
+    // the filter spectra here rather than applied to every output block
+    const float scale = 1.0f / fftSize;
+    const int taps = jmax(0, length - section.firstTap);
+    section.numPartitions = jmin(section.maxPartitions, (taps + B - 1) / B);
+
+    for(int p = 0; p < section.numPartitions; ++p) {
+        // Each partition is zero padded to twice its length
+        for(int j = 0; j < fftSize; ++j) {
+            const int tap = section.firstTap + p * B + j;
+            section.timeScratch[j].r = (j < B && tap < length) ? impulseResponse[tap] * scale : 0.0f;
+            section.timeScratch[j].i = 0.0f;
+        }
+        section.forward->perform(section.timeScratch, section.freqScratch);
+        // Only the non-redundant half of the spectrum of a real signal is kept
+        FFT::Complex* spectrum = section.spectra + p * section.numBins;
+        for(int k = 0; k < section.numBins; ++k)
+            spectrum[k] = section.freqScratch[k];
+    }
+}
+
+size_t ConvolutionKernel::getMemoryUsage() const noexcept
+{
+    size_t bytes = 0;
+    const Section* sections[] = { &head, &tail };
+    for(const Section* s : sections)
+        bytes += sizeof(FFT::Complex) * (size_t) (jmax(1, s->maxPartitions * s->numBins) + s->partitionSize * 4);
+    return bytes;
+}
+
+//==============================================================================
+void PartitionedConvolver::prepare(const ConvolutionKernel& kernel)
+{
+    prepareSection(head, kernel.head);
+    prepareSection(tail, kernel.tail);
+    // One head partition starts each tail block and the next does its
+    // forward transform; the inverse transform takes the last, which
+    // leaves the rest for the products
+    tailStepsPerBlock = jmax(1, kernel.tail.partitionSize / kernel.head.partitionSize - 3);
+    endFade();
+}
+
+void PartitionedConvolver::prepareSection(SectionState& state, const ConvolutionKernel::Section& section)
+{
+    state.partitionSize = section.partitionSize;
+    state.numBins = section.numBins;
+    state.maxPartitions = jmax(1, section.maxPartitions);
+    state.input.allocate(section.partitionSize * 2, true);
+    state.output.allocate(section.partitionSize, true);
+    state.fadeOutput.allocate(section.partitionSize, true);
+    state.pending.allocate(section.partitionSize, true);
+    state.fadePending.allocate(section.partitionSize, true);
+    state.delayLine.allocate(state.maxPartitions * section.numBins, true);
+    // Used for both the time and frequency domain working buffers
+    state.accumulator.allocate(section.partitionSize * 4, true);
+    state.fadeAccumulator.allocate(section.partitionSize * 2, true);
+    resetSection(state);
+}
+
+void PartitionedConvolver::reset() noexcept
+{
+    resetSection(head);
+    resetSection(tail);
+    endFade();
+}
+
+void PartitionedConvolver::resetSection(SectionState& state) noexcept
+{
+    if(state.partitionSize == 0)
+        return;
+    FloatVectorOperations::clear(state.input, state.partitionSize * 2);
+    FloatVectorOperations::clear(state.output, state.partitionSize);
+    FloatVectorOperations::clear(state.pending, state.partitionSize);
+    for(int i = 0; i < state.maxPartitions * state.numBins; ++i)
+        state.delayLine[i].r = state.delayLine[i].i = 0.0f;
+    state.fill = 0;
+    state.delayLinePosition = 0;
+    state.kernel = state.fadeKernel = nullptr;
+    state.transformed = false;
+    state.finished = true;
+    state.outputFaded = false;
+}
+
+void PartitionedConvolver::beginFade(const ConvolutionKernel& oldKernel, const int newFadeLength) noexcept
+{
+    endFade();
+    fadeKernel = &oldKernel;
+    fadeLength = jmax(1, newFadeLength);
+}
+
+// Blocks still being worked out with the old kernel finish without it
+void PartitionedConvolver::endFade() noexcept
+{
+    fadeKernel = nullptr;
+    fadePosition = 0;
+    SectionState* sections[] = { &head, &tail };
+    for(SectionState* s : sections) {
+        s->fadeKernel = nullptr;
+        s->outputFaded = false;
+    }
+}
+
+void PartitionedConvolver::mixInput(float* dest, const float* inA, const float* inB,
+                                    const float gainA, const float gainB, const int numSamples) noexcept
+{
+    if(gainB == 0.0f) {
+        FloatVectorOperations::copy(dest, inA, numSamples);
+        if(gainA != 1.0f)
+            FloatVectorOperations::multiply(dest, gainA, numSamples);
+        return;
+    }
+    for(int i = 0; i < numSamples; ++i)
+        dest[i] = gainA * inA[i] + gainB * inB[i];
+}
+
+void PartitionedConvolver::process(const ConvolutionKernel& kernel, const float* inA, const float* inB,
+                                   const float gainA, const float gainB, float* out, const int numSamples) noexcept
+{
+    const bool useTail = kernel.tail.numPartitions > 0;
+    const int productsPerStep = (kernel.tail.numPartitions + tailStepsPerBlock - 1) / tailStepsPerBlock;
+    int done = 0;
+    while(done < numSamples) {
+        // Work in chunks that end where the head fills a partition, which
+        // is also where the tail fills one. Both sections take their input
+        // before any output is written, so in and out can be the same
+        // buffer.
+        const int chunk = jmin(numSamples - done, head.partitionSize - head.fill);
+
+        mixInput(head.input + head.partitionSize + head.fill, inA + done, inB + done, gainA, gainB, chunk);
+        if(useTail)
+            FloatVectorOperations::copy(tail.input + tail.partitionSize + tail.fill,
+                                        head.input + head.partitionSize + head.fill, chunk);
+        writeOutput(out + done, chunk, useTail);
+
+        head.fill += chunk;
+        if(useTail)
+            tail.fill += chunk;
+        if(head.fill == head.partitionSize) {
+            startBlock(head, kernel.head, fadeKernel != nullptr ? &fadeKernel->head : nullptr);
+            finishBlock(head);
+            publishBlock(head);
+            head.fill = 0;
+            if(useTail) {
+                // The tail block that was started a partition ago is needed
+                // now; a new one starts, and is worked on a step at a time
+                // at each head partition until the next
+                if(tail.fill == tail.partitionSize) {
+                    finishBlock(tail);
+                    publishBlock(tail);
+                    startBlock(tail, kernel.tail, fadeKernel != nullptr ? &fadeKernel->tail : nullptr);
+                    tail.fill = 0;
+                }
+                else {
+                    stepBlock(tail, productsPerStep);
+                }
+            }
+        }
+        done += chunk;
+    }
+}
+
+void PartitionedConvolver::writeOutput(float* out, const int numSamples, const bool useTail) noexcept
+{
+    const float* headNew = head.output + head.fill;
+    const float* tailNew = tail.output + tail.fill;
+    if(fadeKernel == nullptr) {
+        FloatVectorOperations::copy(out, headNew, numSamples);
+        if(useTail)
+            FloatVectorOperations::add(out, tailNew, numSamples);
+        return;
+    }
+
+    // Until both sections have output from blocks worked out with both
+    // kernels, all of it is the old kernel's
+    const float* headOld = head.outputFaded ? head.fadeOutput + head.fill : headNew;
+    const float* tailOld = tail.outputFaded ? tail.fadeOutput + tail.fill : tailNew;
+    const bool fading = head.outputFaded && (tail.outputFaded || ! useTail);
+    const float step = 1.0f / fadeLength;
+    for(int i = 0; i < numSamples; ++i) {
+        const float oldSample = headOld[i] + (useTail ? tailOld[i] : 0.0f);
+        const float newSample = headNew[i] + (useTail ? tailNew[i] : 0.0f);
+        float mix = 0.0f;
+        if(fading) {
+            fadePosition = jmin(fadePosition + 1, fadeLength);
+            mix = fadePosition * step;
+        }
+        out[i] = oldSample + mix * (newSample - oldSample);
+    }
+    if(fadePosition == fadeLength)
+        endFade();
+}
+
+void PartitionedConvolver::startBlock(SectionState& state, const ConvolutionKernel::Section& section,
+                                      const ConvolutionKernel::Section* fadeSection) noexcept
+{
+    // Overlap-save: the last two partitions of input, after which the input
+    // slides along by one partition
+    const int B = state.partitionSize;
+    FFT::Complex* time = state.accumulator;
+    for(int j = 0; j < B * 2; ++j) {
+        time[j].r = state.input[j];
+        time[j].i = 0.0f;
+    }
+    FloatVectorOperations::copy(state.input, state.input + B, B);
+
+    state.kernel = &section;
+    state.fadeKernel = fadeSection;
+    state.nextPartition = 0;
+    state.transformed = false;
+    state.finished = false;
+}
+
+void PartitionedConvolver::stepBlock(SectionState& state, const int maxProducts) noexcept
+{
+    if(state.finished)
+        return;
+    const int fftSize = state.partitionSize * 2;
+    const int numBins = state.numBins;
+    FFT::Complex* freq = state.accumulator + fftSize;
+
+    if(! state.transformed) {
+        // Transform the input and store its spectrum in the frequency domain
+        // delay line
+        state.kernel->forward->perform(state.accumulator, freq);
+        state.newestSlot = state.delayLinePosition;
+        FFT::Complex* newest = state.delayLine + state.newestSlot * numBins;
+        for(int k = 0; k < numBins; ++k)
+            newest[k] = freq[k];
+        state.delayLinePosition = (state.delayLinePosition + 1) % state.maxPartitions;
+        for(int k = 0; k < numBins; ++k) {
+            freq[k].r = freq[k].i = 0.0f;
+            state.fadeAccumulator[k].r = state.fadeAccumulator[k].i = 0.0f;
+        }
+        state.transformed = true;
+        return;
+    }
+
+    const int numPartitions = state.kernel->numPartitions;
+    if(state.nextPartition < numPartitions) {
+        const int end = jmin(numPartitions, state.nextPartition + maxProducts);
+        multiplyAccumulate(freq, state, *state.kernel, state.nextPartition, end);
+        if(state.fadeKernel != nullptr)
+            multiplyAccumulate(state.fadeAccumulator, state, *state.fadeKernel, state.nextPartition,
+                               jmin(end, state.fadeKernel->numPartitions));
+        state.nextPartition = end;
+        return;
+    }
+
+    inverseTransform(state, *state.kernel, freq, state.pending);
+    if(state.fadeKernel != nullptr)
+        inverseTransform(state, *state.fadeKernel, state.fadeAccumulator, state.fadePending);
+    state.finished = true;
+}
+
+void PartitionedConvolver::finishBlock(SectionState& state) noexcept
+{
+    while(! state.finished)
+        stepBlock(state, state.maxPartitions);
+}
+
+// Multiply each past input spectrum with the matching filter partition and
+// accumulate, for partitions first to end-1
+void PartitionedConvolver::multiplyAccumulate(FFT::Complex* dest, const SectionState& state,
+                                              const ConvolutionKernel::Section& section,
+                                              const int first, const int end) noexcept
+{
+    const int numBins = state.numBins;
+    int slot = (state.newestSlot - first % state.maxPartitions + state.maxPartitions) % state.maxPartitions;
+    for(int p = first; p < end; ++p) {
+        const FFT::Complex* x = state.delayLine + slot * numBins;
+        const FFT::Complex* h = section.spectra + p * numBins;
+        for(int k = 0; k < numBins; ++k) {
+            dest[k].r += x[k].r * h[k].r - x[k].i * h[k].i;
+            dest[k].i += x[k].r * h[k].i + x[k].i * h[k].r;
+        }
+        slot = (slot == 0) ? state.maxPartitions - 1 : slot - 1;
+    }
+}
+
+void PartitionedConvolver::inverseTransform(SectionState& state, const ConvolutionKernel::Section& section,
+                                            FFT::Complex* freq, float* dest) noexcept
+{
+    const int B = state.partitionSize;
+    const int fftSize = B * 2;
+    FFT::Complex* time = state.accumulator;
+    // Rebuild the redundant half of the spectrum
+    for(int k = 1; k < B; ++k) {
+        freq[fftSize - k].r = freq[k].r;
+        freq[fftSize - k].i = -freq[k].i;
+    }
+    // The second half of the inverse transform is the valid part of the
+    // circular convolution
+    section.inverse->perform(freq, time);
+    for(int j = 0; j < B; ++j)
+        dest[j] = time[B + j].r;
+}
+
+void PartitionedConvolver::publishBlock(SectionState& state) noexcept
+{
+    FloatVectorOperations::copy(state.output, state.pending, state.partitionSize);
+    state.outputFaded = state.fadeKernel != nullptr;
+    if(state.outputFaded)
+        FloatVectorOperations::copy(state.fadeOutput, state.fadePending, state.partitionSize);
+}
+
+size_t PartitionedConvolver::getMemoryUsage() const noexcept
+{
+    size_t bytes = 0;
+    const SectionState* sections[] = { &head, &tail };
+    for(const SectionState* s : sections)
+        bytes += sizeof(float) * (size_t) (s->partitionSize * 6)
+               + sizeof(FFT::Complex) * (size_t) (s->maxPartitions * s->numBins + s->partitionSize * 6);
+    return bytes;
+}
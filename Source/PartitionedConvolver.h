@@ -0,0 +1,170 @@
+#ifndef __PARTITIONEDCONVOLVER_H__
+#define __PARTITIONEDCONVOLVER_H__
+
+#include "JuceHeader.h"
+#include <memory>
+
+//==============================================================================
+/**
+ * Frequency domain partitions of an FIR filter, for use by one or more
+ * PartitionedConvolvers.
+ *
+ * The impulse response is split non-uniformly: a head section with short
+ * partitions, which sets the latency, and a tail section with long
+ * partitions, which does most of the work at a much lower cost per tap. The
+ * tail starts a whole tail partition later than its own block delay needs,
+ * 2 * tailSize - headSize taps in, so that a convolver has one tail
+ * partition's time to work out each of its blocks (see PartitionedConvolver).
+ *
+ * All memory is allocated in prepare(); setImpulseResponse() doesn't
+ * allocate.
+ */
+class ConvolutionKernel
+{
+public:
+    ConvolutionKernel() {}
+    ~ConvolutionKernel() {}
+
+    // Allocate space for impulse responses of up to maxLength taps.
+    // headSize and tailSize must be powers of two with tailSize > headSize.
+    void prepare (const int maxLength, const int headSize, const int tailSize);
+
+    // Transform an impulse response of up to maxLength taps into partitions.
+    // Doesn't allocate.
+    void setImpulseResponse (const float* impulseResponse, const int length) noexcept;
+
+    // Delay added by a convolver using this kernel, in samples
+    int getLatency() const noexcept { return head.partitionSize; }
+
+    // Bytes allocated by prepare()
+    size_t getMemoryUsage() const noexcept;
+
+private:
+    friend class PartitionedConvolver;
+
+    // One uniformly partitioned part of the impulse response
+    struct Section
+    {
+        int partitionSize = 0;
+        int numBins = 0;            // partitionSize + 1 non-redundant bins
+        int firstTap = 0;           // Offset of the section in the response
+        int maxPartitions = 0;
+        int numPartitions = 0;      // Partitions in use by the current response
+        HeapBlock<FFT::Complex> spectra;    // maxPartitions * numBins
+        HeapBlock<FFT::Complex> timeScratch, freqScratch;
+        std::unique_ptr<FFT> forward, inverse;
+    };
+
+    static void prepareSection (Section& section, const int partitionSize, const int firstTap, const int maxTaps);
+    static void loadSection (Section& section, const float* impulseResponse, const int length) noexcept;
+
+    Section head, tail;
+
+    JUCE_LEAK_DETECTOR (ConvolutionKernel);
+};
+
+//==============================================================================
+/**
+ * Streaming, non-uniformly partitioned overlap-save convolution of one
+ * signal with a ConvolutionKernel. Works with any number of samples per call
+ * and adds ConvolutionKernel::getLatency() samples of delay.
+ *
+ * Each head partition is convolved as soon as it's full. A tail block is
+ * only needed a tail partition after its input is complete, so its work
+ * (the forward transform, the products with each tail partition and the
+ * inverse transform) is spread over the head partitions in between rather
+ * than done in one go.
+ *
+ * The kernel can be swapped for another without a click with beginFade():
+ * every block worked out after that is worked out with both, and once both
+ * sections' output comes from such blocks the output crossfades from the
+ * old kernel's to the new one's. The old kernel must stay unchanged until
+ * getFadeLimit() samples have been processed.
+ */
+class PartitionedConvolver
+{
+public:
+    PartitionedConvolver() {}
+    ~PartitionedConvolver() {}
+
+    // Allocate state for kernels prepared with the same sizes as this one
+    void prepare (const ConvolutionKernel& kernel);
+    // Clears the signal history, and with it any crossfade
+    void reset() noexcept;
+
+    // in and out may be the same
+    void process (const ConvolutionKernel& kernel, const float* in, float* out, const int numSamples) noexcept
+    {
+        process (kernel, in, in, 1.0f, 0.0f, out, numSamples);
+    }
+    // Convolves gainA * inA + gainB * inB, mixing as the input is copied in
+    void process (const ConvolutionKernel& kernel, const float* inA, const float* inB,
+                  const float gainA, const float gainB, float* out, const int numSamples) noexcept;
+
+    // Crossfades over fadeLength samples from oldKernel, the one process()
+    // has been given so far, to the one it's given from now on
+    void beginFade (const ConvolutionKernel& oldKernel, const int fadeLength) noexcept;
+    // Samples after beginFade() by which the crossfade is over, at most
+    int getFadeLimit (const int fadeLength) const noexcept { return tail.partitionSize * 2 + fadeLength; }
+
+    // Bytes allocated by prepare()
+    size_t getMemoryUsage() const noexcept;
+
+private:
+    struct SectionState
+    {
+        HeapBlock<float> input;     // Last two partitions of input
+        HeapBlock<float> output;    // Output of the last completed block
+        HeapBlock<float> fadeOutput;        // The same with the old kernel
+        HeapBlock<float> pending, fadePending;      // Output of the block being worked on
+        HeapBlock<FFT::Complex> delayLine;  // Spectra of past input partitions
+        HeapBlock<FFT::Complex> accumulator;        // Time, then frequency domain
+        HeapBlock<FFT::Complex> fadeAccumulator;    // Frequency domain, old kernel
+        int fill = 0;
+        int delayLinePosition = 0;
+        int partitionSize = 0, numBins = 0, maxPartitions = 0;
+
+        // The block being worked on: the kernels it's for, its newest input
+        // spectrum, and how far through the products it is
+        const ConvolutionKernel::Section* kernel = nullptr;
+        const ConvolutionKernel::Section* fadeKernel = nullptr;
+        int newestSlot = 0;
+        int nextPartition = 0;
+        bool transformed = false, finished = true;
+        bool outputFaded = false;   // fadeOutput holds the old kernel's output
+    };
+
+    static void prepareSection (SectionState& state, const ConvolutionKernel::Section& section);
+    static void resetSection (SectionState& state) noexcept;
+    static void mixInput (float* dest, const float* inA, const float* inB,
+                          const float gainA, const float gainB, const int numSamples) noexcept;
+
+    // Starting a block takes a copy of the input partition that has just
+    // been filled (and the one before it, for overlap-save). Stepping it
+    // does at most maxProducts partition products, or one of the transforms.
+    static void startBlock (SectionState& state, const ConvolutionKernel::Section& section,
+                            const ConvolutionKernel::Section* fadeSection) noexcept;
+    static void stepBlock (SectionState& state, const int maxProducts) noexcept;
+    static void finishBlock (SectionState& state) noexcept;
+    static void multiplyAccumulate (FFT::Complex* dest, const SectionState& state,
+                                    const ConvolutionKernel::Section& section, const int first, const int end) noexcept;
+    static void inverseTransform (SectionState& state, const ConvolutionKernel::Section& section,
+                                  FFT::Complex* freq, float* dest) noexcept;
+    // The finished block becomes the output
+    static void publishBlock (SectionState& state) noexcept;
+
+    // Writes the sections' output, crossfading from the old kernel's to the
+    // new one's once both sections have the new one's
+    void writeOutput (float* out, const int numSamples, const bool useTail) noexcept;
+    void endFade() noexcept;
+
+    SectionState head, tail;
+    int tailStepsPerBlock = 1;      // Head partitions a tail block is spread over
+
+    const ConvolutionKernel* fadeKernel = nullptr;
+    int fadeLength = 0, fadePosition = 0;
+
+    JUCE_LEAK_DETECTOR (PartitionedConvolver);
+};
+
+#endif
@@ -0,0 +1,277 @@
+#ifndef __PERFORMANCEMONITOR_H__
+#define __PERFORMANCEMONITOR_H__
+
+#include "JuceHeader.h"
+
+#if JUCE_INTEL
+ #if JUCE_MSVC
+  #include <intrin.h>
+ #else
+  #include <x86intrin.h>
+ #endif
+#endif
+
+// Set to 0 to compile all processBlock instrumentation out of the plugin
+#ifndef ASSIGNMENT1_INSTRUMENTATION
+ #define ASSIGNMENT1_INSTRUMENTATION 1
+#endif
+
+//==============================================================================
+/**
+ * Per-instance timing counters for the stages of processBlock.
+ *
+ * The audio thread is the only writer. Every counter is an Atomic so that
+ * the editor or a command line tool can read a snapshot at any time without
+ * locking; the snapshot isn't guaranteed to be from a single block but each
+ * value in it is consistent.
+ */
+class PerformanceMonitor
+{
+public:
+    //==============================================================================
+    enum Stage
+    {
+        kUpdateFilter = 0,
+        kUpdateCompressor,
+        kSplit,
+        kCompress,
+        kSum,
+        kSpectral,          // Whole STFT engine, in place of split/compress/sum
+        kAnalysis,          // Loudness and true peak metering of the output
+        kNumStages
+    };
+
+    enum
+    {
+        // Callback time histogram, in 5% steps of the block deadline. The
+        // last bin collects everything at or over 195%.
+        kNumHistogramBins = 40
+    };
+
+    struct Snapshot
+    {
+        // Cycles spent in each stage, summed over all blocks, and the most
+        // spent in any single block
+        int64 stageCycles[kNumStages];
+        int64 stageMaxCycles[kNumStages];
+        int64 numBlocks;
+        // Number of callbacks in each 5% band of the deadline
+        int64 histogram[kNumHistogramBins];
+        // Callbacks that came within the near-xrun threshold of the deadline,
+        // and those that missed it
+        int64 numNearXruns;
+        int64 numXruns;
+        // Largest fraction of the deadline used by a single callback
+        double worstLoad;
+    };
+
+    PerformanceMonitor() noexcept
+        : sampleRate (0), nearXrunThreshold (0.8)
+    {
+        reset();
+    }
+
+    // Called from prepareToPlay
+    void prepare (double newSampleRate) noexcept
+    {
+        sampleRate = newSampleRate;
+        resetRequested.set (1);
+    }
+
+    // Callbacks using at least this fraction of their deadline are counted
+    // as near-xruns
+    void setNearXrunThreshold (double fraction) noexcept
+    {
+        nearXrunThreshold = fraction;
+    }
+
+    // Clears all counters. Safe to call from any thread; the audio thread
+    // does the clearing at the start of its next block.
+    void requestReset() noexcept
+    {
+        resetRequested.set (1);
+    }
+
+    //==============================================================================
+    // Called by the audio thread at the start and end of each callback
+    void beginBlock() noexcept
+    {
+        if (resetRequested.get() != 0)
+        {
+            reset();
+            resetRequested.set (0);
+        }
+        blockStartTicks = Time::getHighResolutionTicks();
+        for (int i = 0; i < kNumStages; ++i)
+            blockStageCycles[i] = 0;
+    }
+
+    void endBlock (const int numSamples) noexcept
+    {
+        const int64 elapsed = Time::getHighResolutionTicks() - blockStartTicks;
+        for (int i = 0; i < kNumStages; ++i)
+        {
+            stageCycles[i] += blockStageCycles[i];
+            if (blockStageCycles[i] > stageMaxCycles[i].get())
+                stageMaxCycles[i].set (blockStageCycles[i]);
+        }
+        ++numBlocks;
+
+        if (sampleRate <= 0 || numSamples <= 0)
+            return;
+        // Fraction of the time available to this block that was used
+        const double deadline = numSamples / sampleRate;
+        const double load = Time::highResolutionTicksToSeconds (elapsed) / deadline;
+        const int bin = jlimit (0, (int) kNumHistogramBins - 1, (int) (load * 20));
+        ++histogram[bin];
+        if (load >= 1.0)
+            ++numXruns;
+        else if (load >= nearXrunThreshold)
+            ++numNearXruns;
+        if (load > worstLoad.get())
+            worstLoad.set (load);
+    }
+
+    // Adds the cycles spent in a stage to the current block
+    void addStageCycles (const Stage stage, const int64 cycles) noexcept
+    {
+        if (! paused)
+            blockStageCycles[stage] += cycles;
+    }
+
+    // While paused, stages aren't counted: for work done over again within
+    // a block, which would otherwise be counted twice. The block itself is
+    // still timed whole.
+    void setPaused (const bool shouldBePaused) noexcept
+    {
+        paused = shouldBePaused;
+    }
+
+    //==============================================================================
+    // Safe to call from any thread
+    void getSnapshot (Snapshot& snapshot) const noexcept
+    {
+        for (int i = 0; i < kNumStages; ++i)
+        {
+            snapshot.stageCycles[i] = stageCycles[i].get();
+            snapshot.stageMaxCycles[i] = stageMaxCycles[i].get();
+        }
+        snapshot.numBlocks = numBlocks.get();
+        for (int i = 0; i < kNumHistogramBins; ++i)
+            snapshot.histogram[i] = histogram[i].get();
+        snapshot.numNearXruns = numNearXruns.get();
+        snapshot.numXruns = numXruns.get();
+        snapshot.worstLoad = worstLoad.get();
+    }
+
+    static const char* getStageName (const Stage stage) noexcept
+    {
+        static const char* const names[] = { "updateFilter", "updateCompressor", "split", "compress", "sum", "spectral", "analysis" };
+        return names[stage];
+    }
+
+    // Reads the CPU's cycle counter where there is one, otherwise the high
+    // resolution timer
+    static inline int64 readCycleCounter() noexcept
+    {
+       #if JUCE_INTEL
+        return (int64) __rdtsc();
+       #else
+        return Time::getHighResolutionTicks();
+       #endif
+    }
+
+    //==============================================================================
+    // Adds the cycles spent in the enclosing scope to a stage
+    class ScopedStage
+    {
+    public:
+        ScopedStage (PerformanceMonitor& m, const Stage s) noexcept
+            : monitor (m), stage (s), start (readCycleCounter())
+        {
+        }
+
+        ~ScopedStage() noexcept
+        {
+            monitor.addStageCycles (stage, readCycleCounter() - start);
+        }
+
+    private:
+        PerformanceMonitor& monitor;
+        const Stage stage;
+        const int64 start;
+
+        JUCE_DECLARE_NON_COPYABLE (ScopedStage);
+    };
+
+    // Brackets a whole processBlock callback
+    class ScopedBlock
+    {
+    public:
+        ScopedBlock (PerformanceMonitor& m, const int n) noexcept
+            : monitor (m), numSamples (n)
+        {
+            monitor.beginBlock();
+        }
+
+        ~ScopedBlock() noexcept
+        {
+            monitor.endBlock (numSamples);
+        }
+
+    private:
+        PerformanceMonitor& monitor;
+        const int numSamples;
+
+        JUCE_DECLARE_NON_COPYABLE (ScopedBlock);
+    };
+
+private:
+    //==============================================================================
+    void reset() noexcept
+    {
+        for (int i = 0; i < kNumStages; ++i)
+        {
+            stageCycles[i].set (0);
+            stageMaxCycles[i].set (0);
+            blockStageCycles[i] = 0;
+        }
+        numBlocks.set (0);
+        for (int i = 0; i < kNumHistogramBins; ++i)
+            histogram[i].set (0);
+        numNearXruns.set (0);
+        numXruns.set (0);
+        worstLoad.set (0);
+        blockStartTicks = 0;
+    }
+
+    double sampleRate, nearXrunThreshold;
+    Atomic<int> resetRequested;
+
+    // Written by the audio thread only
+    int64 blockStartTicks;
+    int64 blockStageCycles[kNumStages];
+    bool paused = false;
+
+    // Readable from any thread
+    Atomic<int64> stageCycles[kNumStages];
+    Atomic<int64> stageMaxCycles[kNumStages];
+    Atomic<int64> numBlocks;
+    Atomic<int64> histogram[kNumHistogramBins];
+    Atomic<int64> numNearXruns, numXruns;
+    Atomic<double> worstLoad;
+
+    JUCE_DECLARE_NON_COPYABLE (PerformanceMonitor);
+};
+
+#if ASSIGNMENT1_INSTRUMENTATION
+ #define ASSIGNMENT1_TIME_BLOCK(monitor, numSamples) \
+    PerformanceMonitor::ScopedBlock JUCE_JOIN_MACRO (blockTimer_, __LINE__) (monitor, numSamples)
+ #define ASSIGNMENT1_TIME_STAGE(monitor, stage) \
+    PerformanceMonitor::ScopedStage JUCE_JOIN_MACRO (stageTimer_, __LINE__) (monitor, stage)
+#else
+ #define ASSIGNMENT1_TIME_BLOCK(monitor, numSamples)
+ #define ASSIGNMENT1_TIME_STAGE(monitor, stage)
+#endif
+
+#endif
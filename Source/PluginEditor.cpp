@@ -0,0 +1,343 @@
+#include "PluginEditor.h"
+
+//==============================================================================
+// A float parameter: its name, then a slider over its range
+class Assignment1Editor::ParameterSlider : public Component,
+                                           public ParameterControl,
+                                           private Slider::Listener
+{
+public:
+    ParameterSlider(AudioParameterFloat& p)
+        : param(p), label(p.name, p.name), slider(p.name)
+    {
+        slider.setRange(param.range.start, param.range.end, param.range.interval);
+        slider.setSliderStyle(Slider::LinearHorizontal);
+        update();
+        slider.addListener(this);
+        addAndMakeVisible(label);
+        addAndMakeVisible(slider);
+    }
+
+    void update() override
+    {
+        slider.setValue(param.get(), dontSendNotification);
+    }
+
+    void resized() override
+    {
+        Rectangle<int> r = getLocalBounds();
+        label.setBounds(r.removeFromLeft(kLabelWidth));
+        slider.setBounds(r);
+    }
+
+private:
+    void sliderValueChanged(Slider*) override { param = (float) slider.getValue(); }
+    void sliderDragStarted(Slider*) override { param.beginChangeGesture(); }
+    void sliderDragEnded(Slider*) override { param.endChangeGesture(); }
+
+    AudioParameterFloat& param;
+    Label label;
+    Slider slider;
+};
+
+//==============================================================================
+// A bool parameter, as a named toggle
+class Assignment1Editor::ParameterToggle : public ToggleButton,
+                                           public ParameterControl
+{
+public:
+    ParameterToggle(AudioParameterBool& p)
+        : ToggleButton(p.name), param(p)
+    {
+        update();
+    }
+
+    void update() override
+    {
+        setToggleState(param.get(), dontSendNotification);
+    }
+
+private:
+    void clicked() override
+    {
+        param.beginChangeGesture();
+        param = getToggleState();
+        param.endChangeGesture();
+    }
+
+    AudioParameterBool& param;
+};
+
+//==============================================================================
+// A choice parameter: its name, then a drop-down list of the choices
+class Assignment1Editor::ParameterChoice : public Component,
+                                           public ParameterControl,
+                                           private ComboBox::Listener
+{
+public:
+    ParameterChoice(AudioParameterChoice& p)
+        : param(p), label(p.name, p.name), box(p.name)
+    {
+        box.addItemList(param.choices, 1);
+        update();
+        box.addListener(this);
+        addAndMakeVisible(label);
+        addAndMakeVisible(box);
+    }
+
+    void update() override
+    {
+        box.setSelectedItemIndex(param.getIndex(), dontSendNotification);
+    }
+
+    void resized() override
+    {
+        Rectangle<int> r = getLocalBounds();
+        label.setBounds(r.removeFromLeft(kLabelWidth));
+        box.setBounds(r);
+    }
+
+private:
+    void comboBoxChanged(ComboBox*) override
+    {
+        param.beginChangeGesture();
+        param = box.getSelectedItemIndex();
+        param.endChangeGesture();
+    }
+
+    AudioParameterChoice& param;
+    Label label;
+    ComboBox box;
+};
+
+//==============================================================================
+// The processor's programs: a drop-down list to pick one, and a button that
+// stores the current settings into the one picked
+class Assignment1Editor::ProgramSelector : public Component,
+                                           private ComboBox::Listener,
+                                           private Button::Listener
+{
+public:
+    ProgramSelector(Assignment1Processor& p)
+        : processor(p), label("program", "Program"), box("program"), storeButton("Store")
+    {
+        for(int i = 0; i < processor.getNumPrograms(); ++i)
+            box.addItem(processor.getProgramName(i), i + 1);
+        update();
+        box.addListener(this);
+        storeButton.addListener(this);
+        addAndMakeVisible(label);
+        addAndMakeVisible(box);
+        addAndMakeVisible(storeButton);
+    }
+
+    // Follows programs picked by the host
+    void update()
+    {
+        if(box.getSelectedItemIndex() != processor.getCurrentProgram())
+            box.setSelectedItemIndex(processor.getCurrentProgram(), dontSendNotification);
+    }
+
+    void resized() override
+    {
+        Rectangle<int> r = getLocalBounds();
+        label.setBounds(r.removeFromLeft(kLabelWidth));
+        storeButton.setBounds(r.removeFromRight(kStoreWidth));
+        box.setBounds(r);
+    }
+
+private:
+    enum { kStoreWidth = 60 };
+
+    void comboBoxChanged(ComboBox*) override
+    {
+        processor.setCurrentProgram(box.getSelectedItemIndex());
+        processor.updateHostDisplay();
+    }
+
+    void buttonClicked(Button*) override
+    {
+        processor.storeProgram(box.getSelectedItemIndex());
+    }
+
+    Assignment1Processor& processor;
+    Label label;
+    ComboBox box;
+    TextButton storeButton;
+};
+
+//==============================================================================
+// Band spectra from the SpectrumAnalyser on a log frequency axis: before
+// compression faintly, after compression solid, and the crossover's response
+// for each band as a thin line
+class Assignment1Editor::SpectrumDisplay : public Component
+{
+public:
+    SpectrumDisplay(const SpectrumAnalyser& a)
+        : analyser(a)
+    {
+        levels.allocate(SpectrumAnalyser::kNumPoints, true);
+        setOpaque(true);
+    }
+
+    void paint(Graphics& g) override
+    {
+        g.fillAll(Colours::black);
+        const int numBands = analyser.getNumBands();
+        for(int band = 0; band < numBands; ++band) {
+            const Colour colour = Colour::fromHSV(band / (float) numBands, 0.7f, 0.9f, 1.0f);
+            analyser.getCrossoverResponse(band, levels);
+            g.setColour(colour.withAlpha(0.5f));
+            g.strokePath(makeCurve(), PathStrokeType(1.0f));
+            analyser.getSpectrum(band, false, levels);
+            g.setColour(colour.withAlpha(0.35f));
+            g.strokePath(makeCurve(), PathStrokeType(1.0f));
+            analyser.getSpectrum(band, true, levels);
+            g.setColour(colour);
+            g.strokePath(makeCurve(), PathStrokeType(1.5f));
+        }
+    }
+
+private:
+    enum { kTopDecibels = 6 };
+
+    // The display points are already log spaced, so they're evenly spread
+    // across the width
+    Path makeCurve() const
+    {
+        Path curve;
+        const float width = (float) getWidth(), height = (float) getHeight();
+        for(int p = 0; p < SpectrumAnalyser::kNumPoints; ++p) {
+            const float x = width * p / (SpectrumAnalyser::kNumPoints - 1);
+            const float y = jmap(levels[p], (float) SpectrumAnalyser::kFloor, (float) kTopDecibels, height, 0.0f);
+            if(p == 0)
+                curve.startNewSubPath(x, y);
+            else
+                curve.lineTo(x, y);
+        }
+        return curve;
+    }
+
+    const SpectrumAnalyser& analyser;
+    HeapBlock<float> levels;
+};
+
+//==============================================================================
+Assignment1Editor::Assignment1Editor(Assignment1Processor& owner)
+    : AudioProcessorEditor(owner),
+      processor(owner),
+      changes(owner.getParameterChanges()),
+      noParameterLabel("noparam", "No parameters available"),
+      loudnessLabel("loudness", String())
+{
+    // The controls are found by parameter index, so applying a change never
+    // has to search for them
+    const OwnedArray<AudioProcessorParameter>& params = processor.getParameters();
+    controlForParameter.assign((size_t) params.size(), nullptr);
+    changed.allocate((size_t) jmax(1, changes.getNumParameters()), true);
+    // Anything that changed before now is shown when the controls are made,
+    // so it needn't be applied again
+    changes.pop(changed, changes.getNumParameters());
+    for(int i = 0; i < params.size(); ++i) {
+        if(AudioParameterFloat* param = dynamic_cast<AudioParameterFloat*>(params[i])) {
+            ParameterSlider* control = new ParameterSlider(*param);
+            rows.add(control);
+            controlForParameter[(size_t) i] = control;
+        }
+        else if(AudioParameterBool* param = dynamic_cast<AudioParameterBool*>(params[i])) {
+            ParameterToggle* control = new ParameterToggle(*param);
+            rows.add(control);
+            controlForParameter[(size_t) i] = control;
+        }
+        else if(AudioParameterChoice* param = dynamic_cast<AudioParameterChoice*>(params[i])) {
+            ParameterChoice* control = new ParameterChoice(*param);
+            rows.add(control);
+            controlForParameter[(size_t) i] = control;
+        }
+    }
+    for(int i = 0; i < rows.size(); ++i)
+        content.addAndMakeVisible(rows[i]);
+    content.setSize(kLabelWidth + kControlWidth, rows.size() * kRowHeight);
+
+    spectrum.reset(new SpectrumDisplay(processor.getSpectrumAnalyser()));
+    addAndMakeVisible(*spectrum);
+    programSelector.reset(new ProgramSelector(processor));
+    addAndMakeVisible(*programSelector);
+
+    viewport.setViewedComponent(&content, false);
+    viewport.setScrollBarsShown(true, false);
+    addAndMakeVisible(viewport);
+    addAndMakeVisible(loudnessLabel);
+
+    noParameterLabel.setJustificationType(Justification::horizontallyCentred | Justification::verticallyCentred);
+    noParameterLabel.setFont(noParameterLabel.getFont().withStyle(Font::italic));
+    if(rows.size() == 0)
+        addAndMakeVisible(noParameterLabel);
+
+    const int scrollBarWidth = rows.size() > kMaxVisibleRows ? viewport.getScrollBarThickness() : 0;
+    setSize(kLabelWidth + kControlWidth + scrollBarWidth,
+            kSpectrumHeight + kRowHeight * (jlimit(1, (int) kMaxVisibleRows, rows.size()) + 2));
+
+    updateMeter();
+    processor.getSpectrumAnalyser().setActive(true);
+    startTimerHz(kFrameRate);
+}
+
+Assignment1Editor::~Assignment1Editor()
+{
+    stopTimer();
+    processor.getSpectrumAnalyser().setActive(false);
+}
+
+void Assignment1Editor::resized()
+{
+    Rectangle<int> r = getLocalBounds();
+    spectrum->setBounds(r.removeFromTop(kSpectrumHeight));
+    programSelector->setBounds(r.removeFromTop(kRowHeight));
+    loudnessLabel.setBounds(r.removeFromBottom(kRowHeight));
+    viewport.setBounds(r);
+    noParameterLabel.setBounds(r);
+    content.setSize(viewport.getMaximumVisibleWidth(), content.getHeight());
+    for(int i = 0; i < rows.size(); ++i)
+        rows[i]->setBounds(0, i * kRowHeight, content.getWidth(), kRowHeight);
+}
+
+void Assignment1Editor::paint(Graphics& g)
+{
+    g.fillAll(Colours::white);
+}
+
+//==============================================================================
+// Applies everything that has changed since the last frame. A parameter that
+// changed many times comes out of the queue once, with its latest value.
+void Assignment1Editor::timerCallback()
+{
+    const int numChanged = changes.pop(changed, changes.getNumParameters());
+    for(int i = 0; i < numChanged; ++i) {
+        if(ParameterControl* control = controlForParameter[(size_t) changed[i]])
+            control->update();
+    }
+    programSelector->update();
+
+    const int version = processor.getSpectrumAnalyser().getVersion();
+    if(version != spectrumVersion) {
+        spectrumVersion = version;
+        spectrum->repaint();
+    }
+
+    if(++frameCount >= kMeterInterval) {
+        frameCount = 0;
+        updateMeter();
+    }
+}
+
+// Label only repaints when the text is different
+void Assignment1Editor::updateMeter()
+{
+    const LoudnessMeter& meter = processor.getLoudnessMeter();
+    loudnessLabel.setText("M " + String(meter.getMomentaryLoudness(), 1)
+                          + "  S " + String(meter.getShortTermLoudness(), 1)
+                          + "  I " + String(meter.getIntegratedLoudness(), 1)
+                          + " LUFS  TP " + String(meter.getTruePeak(), 1) + " dBTP",
+                          dontSendNotification);
+}
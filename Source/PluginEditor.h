@@ -0,0 +1,88 @@
+#ifndef __PLUGINEDITOR_H__
+#define __PLUGINEDITOR_H__
+
+#include "JuceHeader.h"
+#include "PluginProcessor.h"
+#include <vector>
+#include <memory>
+
+//==============================================================================
+/**
+ * Editor built from the processor's parameter list: a labelled slider for
+ * every float parameter, a toggle for every bool and a drop-down list for
+ * every choice, in a scrolling list so that it stays a usable size however
+ * many bands there are.
+ *
+ * Nothing is polled. Every change to a parameter, from the host, queued
+ * automation or the editor itself, goes through the processor's
+ * setParameter(), which marks it in a ParameterChangeQueue. Once a frame the
+ * editor takes whatever has changed since the last one and updates just
+ * those controls, so an idle editor costs one atomic read a frame and only
+ * the controls that move get repainted.
+ *
+ * Above the controls, a SpectrumAnalyser display shows the spectrum of each
+ * band of the first channel before and after compression, with the
+ * crossover's response. It's only repainted when the analyser has new
+ * readings. Below it, the programs can be picked, and the current settings
+ * stored into one.
+ */
+class Assignment1Editor : public AudioProcessorEditor,
+                          private Timer
+{
+public:
+    enum
+    {
+        kRowHeight = 25,
+        kLabelWidth = 130,
+        kControlWidth = 300,
+        kMaxVisibleRows = 24,
+        kFrameRate = 60,
+        kMeterInterval = 6,     // Frames between loudness readings
+        kSpectrumHeight = 160
+    };
+
+    Assignment1Editor (Assignment1Processor& owner);
+    ~Assignment1Editor();
+
+    void resized() override;
+    void paint (Graphics& g) override;
+
+private:
+    // A control that shows (and edits) one parameter
+    class ParameterControl
+    {
+    public:
+        virtual ~ParameterControl() {}
+        // Shows the parameter's current value, without notifying anyone
+        virtual void update() = 0;
+    };
+    class ParameterSlider;
+    class ParameterToggle;
+    class ParameterChoice;
+    class ProgramSelector;
+    class SpectrumDisplay;
+
+    void timerCallback() override;
+    void updateMeter();
+
+    Assignment1Processor& processor;
+    ParameterChangeQueue& changes;
+
+    std::unique_ptr<SpectrumDisplay> spectrum;
+    std::unique_ptr<ProgramSelector> programSelector;
+    int spectrumVersion = -1;
+    Viewport viewport;
+    Component content;
+    OwnedArray<Component> rows;         // One per control, top to bottom
+    // Indexed by parameter, nullptr for a parameter that has no control
+    std::vector<ParameterControl*> controlForParameter;
+    HeapBlock<int> changed;
+
+    Label noParameterLabel;
+    Label loudnessLabel;
+    int frameCount = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Assignment1Editor);
+};
+
+#endif
@@ -28,12 +28,20 @@
 */
 
 #include "PluginProcessor.h"
+#include "PluginEditor.h"
 #include <memory>
-
+#include <algorithm>
 #include <string>
 
 //==============================================================================
+// A main bus (stereo by default, anything up to kMaxChannels - see
+// isBusesLayoutSupported), plus an optional sidechain input that hosts can
+// enable to key the compressors from another track
 Assignment1Processor::Assignment1Processor()
+    : AudioProcessor (BusesProperties()
+                        .withInput  ("Input",     AudioChannelSet::stereo())
+                        .withOutput ("Output",    AudioChannelSet::stereo())
+                        .withInput  ("Sidechain", AudioChannelSet::stereo(), false))
 {
     // Define the number of crossover filters and compressors on each channel
     numXOverPerChannel = 3;
@@ -47,6 +55,22 @@ Assignment1Processor::Assignment1Processor()
     compressorActive.resize(numCompPerChannel);
     compressorAttack.resize(numCompPerChannel);
     compressorRelease.resize(numCompPerChannel);
+    compressorKnee.resize(numCompPerChannel);
+    sideActive.resize(numCompPerChannel);
+    sideThresh.resize(numCompPerChannel);
+    sideRatio.resize(numCompPerChannel);
+    sideGain.resize(numCompPerChannel);
+    sideAttack.resize(numCompPerChannel);
+    sideRelease.resize(numCompPerChannel);
+    sideKnee.resize(numCompPerChannel);
+    bandSolo.resize(numCompPerChannel);
+    bandMute.resize(numCompPerChannel);
+    bandBypass.resize(numCompPerChannel);
+    bandStates_.resize(numCompPerChannel, { 1.0f, 1.0f, 1.0f, 1.0f, true, true });
+    crossoverFreqValues_.resize(numXOverPerChannel);
+    // One static curve per band, shared by every channel, and another for
+    // the side compressors in mid/side mode
+    curves_.resize(numCompPerChannel * 2);
 
     // Add crossover parameters to the UI using JUCE's generic GUI editior
     for(int i = 0; i < numXOverPerChannel; i++) {
@@ -82,12 +106,122 @@ Assignment1Processor::Assignment1Processor()
         s2 = std::string("Compressor " + std::to_string(i+1) + " release");
         addParameter (compressorRelease[i] = new AudioParameterFloat (s1, s2, NormalisableRange<float>(0.1, 1000, 0.1, 1.0f), 0.0f));
     }
+
+    // Knee widths are added after the original compressor parameters so that
+    // the indices hosts use to automate those don't change
+    for(int i = 0; i < numCompPerChannel; i++) {
+        std::string s1 = "comp" + std::to_string(i+1) + "knee";
+        std::string s2 = "Compressor " + std::to_string(i+1) + " Knee";
+        addParameter (compressorKnee[i] = new AudioParameterFloat (s1, s2, NormalisableRange<float>(0.0f, 24.0f, 0.1f, 1.0f), 0.0f));
+    }
+
+    // Add control rate gain computation settings shared by all compressors
+    addParameter (controlRateActive = new AudioParameterBool ("controlRate", "Control Rate Gain", false));
+    addParameter (controlRateInterval = new AudioParameterFloat ("controlRateInterval", "Control Rate Interval",
+                NormalisableRange<float>(Compressor::kMinControlInterval, Compressor::kMaxControlInterval, 1.0f, 1.0f), 16.0f));
+
+    // Switch between the Linkwitz-Riley and linear-phase FIR crossovers
+    addParameter (linearPhaseActive = new AudioParameterBool ("linearPhase", "Linear Phase Crossover", false));
+
+    // Switch to the STFT engine for high band counts
+    addParameter (spectralActive = new AudioParameterBool ("spectral", "Spectral Multiband", false));
+    addParameter (spectralBands = new AudioParameterFloat ("spectralBands", "Spectral Bands",
+                NormalisableRange<float>(SpectralMultiband::kMinBands, SpectralMultiband::kMaxBands, 1.0f, 1.0f), 24.0f));
+
+    // Split blocks at timestamped parameter changes (see queueParameterChange)
+    addParameter (sampleAccurateActive = new AudioParameterBool ("sampleAccurate", "Sample Accurate Automation", false));
+    automationEvents_.allocate(automation_.getCapacity(), true);
+
+    // Key every band's detector from the sidechain bus rather than from
+    // the band itself
+    addParameter (sidechainActive = new AudioParameterBool ("sidechain", "External Sidechain", false));
+
+    // Mid/side processing of stereo input. The compressor settings above
+    // apply to the mid signal and these to the side.
+    addParameter (midSideActive = new AudioParameterBool ("midSide", "Mid/Side", false));
+    for(int i = 0; i < numCompPerChannel; i++) {
+        std::string s1 = "comp" + std::to_string(i+1) + "sideactive";
+        std::string s2 = "Compressor " + std::to_string(i+1) + " Side Active";
+        addParameter (sideActive[i] = new AudioParameterBool (s1, s2, false));
+
+        s1 = std::string("comp" + std::to_string(i+1) + "sidethresh");
+        s2 = std::string("Compressor " + std::to_string(i+1) + " Side Threshold");
+        addParameter (sideThresh[i] = new AudioParameterFloat (s1, s2, NormalisableRange<float>(-60.0f, 0.0f, 1.0f, 1.0f), 0.0f));
+
+        s1 = std::string("comp" + std::to_string(i+1) + "sideratio");
+        s2 = std::string("Compressor " + std::to_string(i+1) + " Side Ratio");
+        addParameter (sideRatio[i] = new AudioParameterFloat (s1, s2, NormalisableRange<float>(1.0f, 100.0f, 0.1f, 1.0f), 1.0f));
+
+        s1 = std::string("comp" + std::to_string(i+1) + "sidegain");
+        s2 = std::string("Compressor " + std::to_string(i+1) + " Side Gain");
+        addParameter (sideGain[i] = new AudioParameterFloat (s1, s2, NormalisableRange<float>(0, 40, 1, 1.0f), 0.0f));
+
+        s1 = std::string("comp" + std::to_string(i+1) + "sideattack");
+        s2 = std::string("Compressor " + std::to_string(i+1) + " Side Attack");
+        addParameter (sideAttack[i] = new AudioParameterFloat (s1, s2, NormalisableRange<float>(0.1, 80, 0.1, 1.0f), 0.0f));
+
+        s1 = std::string("comp" + std::to_string(i+1) + "siderelease");
+        s2 = std::string("Compressor " + std::to_string(i+1) + " Side Release");
+        addParameter (sideRelease[i] = new AudioParameterFloat (s1, s2, NormalisableRange<float>(0.1, 1000, 0.1, 1.0f), 0.0f));
+
+        s1 = std::string("comp" + std::to_string(i+1) + "sideknee");
+        s2 = std::string("Compressor " + std::to_string(i+1) + " Side Knee");
+        addParameter (sideKnee[i] = new AudioParameterFloat (s1, s2, NormalisableRange<float>(0.0f, 24.0f, 0.1f, 1.0f), 0.0f));
+    }
+
+    // Share detection between groups of channels, one choice per
+    // ChannelLink. Added after the side parameters so their indices don't
+    // change.
+    static const char* const linkNames[] = { "Off", "Pairs", "All" };
+    addParameter (channelLink = new AudioParameterChoice ("channelLink", "Channel Link",
+                StringArray(linkNames, numElementsInArray(linkNames)), kLinkOff));
+
+    // Spread each stage over the worker threads shared by every instance
+    addParameter (sharedThreadsActive = new AudioParameterBool ("sharedThreads", "Shared DSP Threads", false));
+
+    // Measure the loudness and true peak of the output (see getLoudnessMeter)
+    addParameter (loudnessActive = new AudioParameterBool ("loudness", "Loudness Meter", false));
+
+    // Audition controls for each band. Soloing any band silences every band
+    // that isn't soloed; a bypassed band passes through uncompressed.
+    for(int i = 0; i < numCompPerChannel; i++) {
+        std::string s1 = "band" + std::to_string(i+1) + "solo";
+        std::string s2 = "Band " + std::to_string(i+1) + " Solo";
+        addParameter (bandSolo[i] = new AudioParameterBool (s1, s2, false));
+
+        s1 = std::string("band" + std::to_string(i+1) + "mute");
+        s2 = std::string("Band " + std::to_string(i+1) + " Mute");
+        addParameter (bandMute[i] = new AudioParameterBool (s1, s2, false));
+
+        s1 = std::string("band" + std::to_string(i+1) + "bypass");
+        s2 = std::string("Band " + std::to_string(i+1) + " Bypass");
+        addParameter (bandBypass[i] = new AudioParameterBool (s1, s2, false));
+    }
+
+    // Program-dependent release for every compressor (see
+    // Compressor::autoReleaseBallistics). A sine is released over the
+    // release time less the attack time, steadier material more slowly (up
+    // to twice the release time) and transients faster, down to the longer
+    // of the attack time and Compressor::kMinAutoReleaseMs.
+    addParameter (autoReleaseActive = new AudioParameterBool ("autoRelease", "Auto Release", false));
+
+    // Made from the defaults above, so this comes after every parameter
+    createFactoryPrograms();
+
+    parameterChanges_.prepare(getNumParameters());
+    automatedParameters_.prepare(getNumParameters());
+    automatedIndices_.allocate(getNumParameters(), true);
+    traceWriter_->addBuffer(&trace_);
+    startTimerHz(kMessagePollHz);
 }
 
-// Empty destructor as all dynamic memory is handled using std containers and
-// unique_ptrs
+// All dynamic memory is handled using std containers and unique_ptrs, so the
+// destructor only needs to stop the trace writer reading from this instance
+// and the message thread polling it
 Assignment1Processor::~Assignment1Processor()
 {
+    stopTimer();
+    traceWriter_->removeBuffer(&trace_);
 }
 
 //==============================================================================
@@ -98,6 +232,14 @@ const String Assignment1Processor::getName() const
     return JucePlugin_Name;
 }
 
+// Host automation, queued automation and the editor's own edits all end up
+// here. Marking the change is wait-free, so this is safe on the audio thread.
+void Assignment1Processor::setParameter (int index, float newValue)
+{
+    AudioProcessor::setParameter (index, newValue);
+    parameterChanges_.push (index);
+}
+
 const String Assignment1Processor::getInputChannelName (int channelIndex) const
 {
     return String (channelIndex + 1);
@@ -110,11 +252,31 @@ const String Assignment1Processor::getOutputChannelName (int channelIndex) const
 
 bool Assignment1Processor::isInputChannelStereoPair (int index) const
 {
-    return true;
+    return getMainBusNumInputChannels() == 2;
 }
 
 bool Assignment1Processor::isOutputChannelStereoPair (int index) const
 {
+    return getMainBusNumOutputChannels() == 2;
+}
+
+// The main input and output must match and have 1 to kMaxChannels channels.
+// Every channel is processed the same way, so any named layout (mono
+// through 7.1.4), ambisonic order up to 7 or set of discrete channels is
+// accepted by its size. The sidechain can be off, mono or stereo.
+bool Assignment1Processor::isBusesLayoutSupported (const BusesLayout& layouts) const
+{
+    const AudioChannelSet& mainIn = layouts.getMainInputChannelSet();
+    if (mainIn != layouts.getMainOutputChannelSet())
+        return false;
+    if (mainIn.size() < 1 || mainIn.size() > kMaxChannels)
+        return false;
+    if (layouts.inputBuses.size() > 1)
+    {
+        const AudioChannelSet& key = layouts.getChannelSet(true, 1);
+        if (! key.isDisabled() && key != AudioChannelSet::mono() && key != AudioChannelSet::stereo())
+            return false;
+    }
     return true;
 }
 
@@ -152,25 +314,41 @@ bool Assignment1Processor::producesMidi() const
 
 int Assignment1Processor::getNumPrograms()
 {
-    return 0;
+    return programs_.getNumPrograms();
 }
 
 int Assignment1Processor::getCurrentProgram()
 {
-    return 0;
+    return programs_.getCurrentProgram();
 }
 
+// The audio thread picks the program up at the start of its next block (see
+// applyPendingProgram)
 void Assignment1Processor::setCurrentProgram (int index)
 {
+    programs_.select(index);
 }
 
 const String Assignment1Processor::getProgramName (int index)
 {
-    return String::empty;
+    const ProgramBank::Program* program = programs_.getProgram(index);
+    return program != nullptr ? program->name : String::empty;
 }
 
 void Assignment1Processor::changeProgramName (int index, const String& newName)
 {
+    if (ProgramBank::Program* program = programs_.getProgram(index))
+        program->name = newName;
+}
+
+void Assignment1Processor::storeProgram (int index)
+{
+    const ProgramBank::Program* old = programs_.getProgram(index);
+    if (old == nullptr)
+        return;
+    ProgramBank::Program* program = createProgram(old->name);
+    prepareProgram(*program, getSampleRate());
+    programs_.replaceProgram(index, program);
 }
 //==============================================================================
 
@@ -184,10 +362,20 @@ void Assignment1Processor::prepareToPlay (double sampleRate, int samplesPerBlock
     // Crossover filter initialisation
     //////////////////////////////////////////////////////////////////////////
     // Get info about host for compressor/filter initialization
-    numChannels = getNumInputChannels();
-    numCrossoverFilters_ = numChannels;
+    // Everything per channel below is allocated for the negotiated layout
+    numChannels = jmin((int) kMaxChannels, getMainBusNumInputChannels());
+    // Sidechain channels get their own row of crossover filters (and bands
+    // in bandBuffer_) after the main channels, with the same coefficients
+    const Bus* sidechain = getBus(true, 1);
+    numKeyChannels_ = (sidechain != nullptr && sidechain->isEnabled()) ? sidechain->getNumberOfChannels() : 0;
+    numCrossoverFilters_ = numChannels + numKeyChannels_;
+    keyed_ = *sidechainActive && numKeyChannels_ > 0;
     int bufferSize = getBlockSize();
 
+    // Pick the widest instruction set variant of the DSP kernels this CPU
+    // supports. The CPU is only checked the first time.
+    kernels_ = &DSPKernels::getBest();
+
     // Allocate memory for filter objects
     crossoverFilters_.resize(numCrossoverFilters_);
     for( auto &it : crossoverFilters_ )
@@ -202,10 +390,37 @@ void Assignment1Processor::prepareToPlay (double sampleRate, int samplesPerBlock
         for (row = crossoverFilters_.begin(); row != crossoverFilters_.end(); row++) {
             for (col = row->begin(); col != row->end(); col++) {
                 *col = std::make_unique<CrossoverFilter>(false, true);
+                (*col)->setKernels(*kernels_);
             }
         }
     }
 
+    // Allocate the linear-phase crossover whether or not it is in use, so
+    // that switching to it never allocates, and design its filters for the
+    // current crossovers here so there are always some to switch to. After
+    // this they're designed away from the audio thread (see processSegment).
+    linearPhase_.prepare(sampleRate, numCrossoverFilters_, numXOverPerChannel+1);
+    linearPhaseEnabled_ = *linearPhaseActive;
+    for(int i = 0; i < numXOverPerChannel; i++)
+        crossoverFreqValues_[i] = *crossoverFreq[i];
+    linearPhase_.setCrossoverFrequencies(crossoverFreqValues_.data());
+    linearPhase_.designKernels();
+    // The same goes for the spectral engine
+    spectral_.prepare(sampleRate, numChannels);
+    for(int i = 0; i < numChannels; i++)
+        for(int j = 0; j < SpectralMultiband::kMaxBands; j++)
+            spectral_.getCompressor(i, j).setKernels(*kernels_);
+    spectral_.setNumBands((int) *spectralBands);
+    spectralEnabled_ = *spectralActive;
+    midSideEnabled_ = *midSideActive && numChannels == 2;
+    // Offline quality mode adds the true peak detectors' latency
+    highQuality_ = isNonRealtime();
+    pendingLatency_.set(getEngineLatency());
+    setLatencySamples(pendingLatency_.get());
+
+    // The analyser is told the crossover's coefficients by updateFilter
+    analyser_.prepare(sampleRate, numCompPerChannel);
+
     // Update the filter settings to work with the current parameters and sample rate
     updateFilter(sampleRate);
 
@@ -219,25 +434,63 @@ void Assignment1Processor::prepareToPlay (double sampleRate, int samplesPerBlock
         it.resize(numCompPerChannel);
     }
 
-    // Create required number of compressors
-    if(compressors_.size() != 0) {
-        std::vector<std::vector<std::unique_ptr<Compressor>> >::iterator row;
-        std::vector<std::unique_ptr<Compressor>>::iterator col;
-        for (row = compressors_.begin(); row != compressors_.end(); row++) {
-            for (col = row->begin(); col != row->end(); col++) {
-                *col = std::make_unique<Compressor>(bufferSize);
-            }
+    // Create required number of compressors. The bands of a channel are
+    // compressed one after another, so they share one row of scratch.
+    compressorScratch_.setSize(numChannels, bufferSize);
+    for(int i = 0; i < numChannels; i++) {
+        for(int j = 0; j < numCompPerChannel; j++) {
+            compressors_[i][j] = std::make_unique<Compressor>(&curves_[j]);
+            compressors_[i][j]->setKernels(*kernels_);
+            compressors_[i][j]->setScratch(compressorScratch_.getWritePointer(i), bufferSize);
         }
     }
     // Update the compressor settings to work with the current parameters and sample rate
     updateCompressor(sampleRate);
+
+    // Bands start at their settings rather than fading to them, once there
+    // are filters and compressors for them to reset
+    updateBands(1.0f);
+
+    // Allocate storage for the sub-bands of every channel so nothing needs
+    // to be allocated while processing
+    bandBuffer_.setSize(numCrossoverFilters_ * numCompPerChannel, bufferSize);
+    bandBuffer_.clear();
+    // Band pointers for summing each channel (twice as many for mid/side),
+    // and detector pointers and scratch for each group of linked channels,
+    // so that channels and groups can be processed in parallel
+    bandPointers_.resize(numChannels * numCompPerChannel * 2);
+    linkPointers_.resize(numChannels);
+    linkBuffer_.setSize(numChannels, bufferSize);
+    // The offline quality mode's true peak detectors are set up whether or
+    // not the host is rendering, so that switching is free
+    truePeak_.prepare(sampleRate, numChannels * numCompPerChannel);
+    truePeakBuffer_.setSize(numChannels, bufferSize);
+
+    // Every program's tables are made for this sample rate, and the program
+    // crossfade gets room for a copy of everything it processes twice
+    for(int i = 0; i < programs_.getNumPrograms(); i++)
+        prepareProgram(*programs_.getProgram(i), sampleRate);
+    filterSnapshot_.assign(numCrossoverFilters_ * numXOverPerChannel * 2, CrossoverFilter(false, true));
+    envelopeSnapshot_.resize(numChannels * numCompPerChannel);
+    bandSnapshot_ = bandStates_;
+    truePeakSnapshot_.prepare(sampleRate, numChannels * numCompPerChannel);
+    programFadeBuffer_.setSize(numChannels * 2, jmin(bufferSize, (int) (kProgramFadeMs * 0.001 * sampleRate)));
+
+    loudness_.prepare(sampleRate, numChannels);
+    loudness_.setChannelLayout(getChannelLayoutOfBus(false, 0));
+
+    performance_.prepare(sampleRate);
 }
 
 void Assignment1Processor::releaseResources()
 {
     compressors_.clear();
     crossoverFilters_.clear();
-
+    bandBuffer_.setSize(0, 0);
+    linkBuffer_.setSize(0, 0);
+    compressorScratch_.setSize(0, 0);
+    truePeakBuffer_.setSize(0, 0);
+    programFadeBuffer_.setSize(0, 0);
 }
 
 void Assignment1Processor::processBlock (AudioSampleBuffer& buffer, MidiBuffer& midiMessages)
@@ -246,93 +499,564 @@ void Assignment1Processor::processBlock (AudioSampleBuffer& buffer, MidiBuffer&
     // Audio processing block
     //////////////////////////////////////////////////////////////////////////
     // Helpful information about this block of samples:
-    const int numInputChannels = getNumInputChannels();     // How many input channels for our effect?
-    const int numOutputChannels = getNumOutputChannels();   // How many output channels for our effect?
+    const int numInputChannels = getMainBusNumInputChannels();      // How many input channels for our effect?
+    const int numOutputChannels = getMainBusNumOutputChannels();    // How many output channels for our effect?
     const int numSamples = buffer.getNumSamples();          // How many samples in the buffer for this block?
-    // Calculate the total number of frequency bands
+    // Only process the channels that filters and compressors were allocated
+    // for in prepareToPlay
+    const int numProcessedChannels = jmin(numInputChannels, numOutputChannels, numChannels);
+    jassert (numSamples <= bandBuffer_.getNumSamples());
+
+    ASSIGNMENT1_REALTIME_SCOPE();
+    ASSIGNMENT1_TIME_BLOCK (performance_, numSamples);
+    ASSIGNMENT1_TRACE_SCOPE (trace_, "processBlock", numSamples);
+
+    // Apply timestamped parameter changes. In sample accurate mode the block
+    // is split at each change so the new value takes effect on exactly that
+    // sample; otherwise every change is applied at the start of the block it
+    // falls in. Either way the extra cost is one parameter update per
+    // change. Changes for later blocks stay queued.
+    const int numEvents = automation_.popBlock(automationEvents_, numSamples);
+    const bool sampleAccurate = *sampleAccurateActive || isNonRealtime();
+    // A new program takes effect before any of this block's automation
+    int start = applyPendingProgram(buffer, numSamples, numProcessedChannels);
+    for (int i = 0; i < numEvents; ++i)
+    {
+        const AutomationEvent& event = automationEvents_[i];
+        const int offset = sampleAccurate ? jlimit(start, numSamples, event.sampleOffset) : 0;
+        if (offset > start)
+        {
+            processSegment(buffer, start, offset - start, numProcessedChannels);
+            start = offset;
+        }
+        if (isPositiveAndBelow(event.parameterIndex, getNumParameters()))
+        {
+            setParameter(event.parameterIndex, event.value);
+            // Telling the host takes a lock, so the message thread picks
+            // the change up and tells it (see timerCallback)
+            automatedParameters_.push(event.parameterIndex);
+        }
+        ASSIGNMENT1_TRACE_INSTANT (trace_, "automation", event.parameterIndex);
+    }
+    if (start < numSamples || numSamples == 0)
+        processSegment(buffer, start, numSamples - start, numProcessedChannels);
+
+    // Go through the remaining channels. In case we have more outputs
+    // than inputs, or there aren't enough filters, we'll clear any
+    // remaining output channels (which could otherwise contain garbage)
+    for (int channel = numProcessedChannels; channel < numOutputChannels; ++channel)
+    {
+        buffer.clear (channel, 0, buffer.getNumSamples());
+    }
+
+    // Measure what's going out, after everything else. Switching the meter
+    // back on starts its readings afresh, so nothing measured before it was
+    // switched off counts towards them.
+    const bool loudness = *loudnessActive;
+    if (loudness && ! loudnessEnabled_)
+        loudness_.requestReset();
+    loudnessEnabled_ = loudness;
+    if (loudness)
+    {
+        ASSIGNMENT1_TIME_STAGE (performance_, PerformanceMonitor::kAnalysis);
+        ASSIGNMENT1_TRACE_SCOPE (trace_, "analysis", numSamples);
+        loudness_.process(buffer.getArrayOfReadPointers(), numProcessedChannels, numSamples);
+    }
+}
+
+// Process numSamples samples of the host's buffer from startSample, with the
+// parameters as they are at the start of the segment
+void Assignment1Processor::processSegment(AudioSampleBuffer& buffer, const int startSample, const int numSamples,
+                                          const int numProcessedChannels)
+{
+    // Update parameters of all effects on each segment. This seems excessive
+    // to perform in the processing block, but a function that is only called
+    // reliably on parameter changes wasn't found. The engine is chosen first
+    // as the compressor settings depend on it.
+    {
+        ASSIGNMENT1_TIME_STAGE (performance_, PerformanceMonitor::kUpdateFilter);
+        updateEngine();
+    }
+    {
+        ASSIGNMENT1_TIME_STAGE (performance_, PerformanceMonitor::kUpdateCompressor);
+        updateCompressor(getSampleRate());
+    }
+    {
+        ASSIGNMENT1_TIME_STAGE (performance_, PerformanceMonitor::kUpdateFilter);
+        updateFilter(getSampleRate());
+    }
+    // New FIR filters take far longer to design than a block, so they're
+    // designed on the message thread (see timerCallback) and crossfaded to
+    // once they're ready.
+    // Offline nothing is waiting on the block, and the result shouldn't
+    // depend on when the message thread gets round to it, so they're
+    // designed here.
+    if (linearPhaseEnabled_ && linearPhase_.beginSegment(numSamples))
+    {
+        if (highQuality_)
+            linearPhase_.designKernels();
+        else
+            designWanted_.set(1);
+    }
+
+    // Everything the stage jobs below need to know about this segment
+    segment_.buffer = &buffer;
+    segment_.startSample = startSample;
+    segment_.numSamples = numSamples;
+    segment_.numProcessedChannels = numProcessedChannels;
+    // Sidechain channels to split, if the compressors are keyed externally
+    segment_.numKeyChannels = keyed_ ? numKeyChannels_ : 0;
+    segment_.groupSize = getLinkGroupSize(numProcessedChannels);
+    // Mid and side take the place of the first two channels
+    segment_.numMainRows = midSideEnabled_ ? 2 : numProcessedChannels;
+
+    // Each stage is a set of independent jobs (see runJobs). The jobs don't
+    // trace, as they may run on other threads.
+    if (spectralEnabled_)
+    {
+        // The spectral engine replaces all three crossover stages and works
+        // on the host's buffer in place
+        ASSIGNMENT1_TIME_STAGE (performance_, PerformanceMonitor::kSpectral);
+        ASSIGNMENT1_TRACE_SCOPE (trace_, "spectral", -1);
+        runJobs(&Assignment1Processor::spectralJob, numProcessedChannels);
+    }
+    else
+    {
+        // Processing is done in three stages so that each can be timed
+        // separately. The sub-bands of every channel are kept in bandBuffer_
+        // (preallocated in prepareToPlay), which lets the final stage write the
+        // sum straight back into the host's buffer.
+        // Muted bands aren't split, compressed or summed, and bypassed ones
+        // aren't compressed, once they've faded out
+        updateBands(numSamples * 1000.0f / (kBandFadeMs * (float) getSampleRate()));
+
+        // While an editor shows the analyser, the first channel's bands are
+        // copied to it before and after compression.
+        const bool analysing = analyser_.isActive() && numProcessedChannels > 0 && ! fadingOut_;
+
+        // Apply each filter to create sub-bands
+        {
+            ASSIGNMENT1_TIME_STAGE (performance_, PerformanceMonitor::kSplit);
+            ASSIGNMENT1_TRACE_SCOPE (trace_, "split", -1);
+            runJobs(&Assignment1Processor::splitJob, segment_.numMainRows + segment_.numKeyChannels);
+        }
+        if (analysing)
+            pushBandsToAnalyser(false);
+
+        // Apply compressor to each filtered subband
+        {
+            ASSIGNMENT1_TIME_STAGE (performance_, PerformanceMonitor::kCompress);
+            ASSIGNMENT1_TRACE_SCOPE (trace_, "compress", -1);
+            const int numGroups = (numProcessedChannels + segment_.groupSize - 1) / segment_.groupSize;
+            runJobs(&Assignment1Processor::compressJob, numGroups);
+        }
+        if (analysing)
+            pushBandsToAnalyser(true);
+
+        // Add subbands to the output block
+        {
+            ASSIGNMENT1_TIME_STAGE (performance_, PerformanceMonitor::kSum);
+            ASSIGNMENT1_TRACE_SCOPE (trace_, "sum", -1);
+            runJobs(&Assignment1Processor::sumJob, midSideEnabled_ ? 1 : numProcessedChannels);
+        }
+    }
+}
+
+// Runs once per segment, before the stage jobs, which only read the states
+void Assignment1Processor::updateBands(const float fadeStep)
+{
+    bool anySolo = false;
+    for (int band = 0; band < numCompPerChannel; ++band)
+        anySolo = anySolo || *bandSolo[band];
+
+    for (int band = 0; band < numCompPerChannel; ++band)
+    {
+        BandState& state = bandStates_[band];
+        const bool audible = anySolo ? *bandSolo[band] : ! *bandMute[band];
+        const float levelTarget = audible ? 1.0f : 0.0f;
+        const float mixTarget = *bandBypass[band] ? 0.0f : 1.0f;
+        state.levelStart = state.level;
+        state.level = state.level < levelTarget ? jmin(levelTarget, state.level + fadeStep)
+                                                : jmax(levelTarget, state.level - fadeStep);
+        state.mixStart = state.mix;
+        state.mix = state.mix < mixTarget ? jmin(mixTarget, state.mix + fadeStep)
+                                          : jmax(mixTarget, state.mix - fadeStep);
+
+        // A band's filters (and its key's) have missed whatever went by
+        // while they were skipped, so they start again from silence under
+        // the fade in. So do its compressors' envelopes, rather than
+        // carrying on from wherever they were when the band was bypassed.
+        const bool active = state.levelStart > 0 || state.level > 0;
+        const bool compressed = active && (state.mixStart > 0 || state.mix > 0);
+        if (active && ! state.active)
+            resetBand(band, 0, numChannels);
+        if (compressed && ! state.compressed)
+        {
+            resetBand(band, numChannels, numCrossoverFilters_);
+            for (int channel = 0; channel < numChannels; ++channel)
+                compressors_[channel][band]->resetEnvelope();
+        }
+        state.active = active;
+        state.compressed = compressed;
+    }
+}
+
+void Assignment1Processor::resetBand(const int band, const int firstRow, const int endRow)
+{
+    const int numBands = numXOverPerChannel+1;
+    const int first = (band == 0) ? 0 : (band*2)-1;
+    const int last = (band == numBands-1) ? (band*2)-1 : band*2;
+    for (int row = firstRow; row < jmin(endRow, (int) crossoverFilters_.size()); ++row)
+    {
+        for (int i = first; i <= last; ++i)
+            crossoverFilters_[row][i]->reset();
+        if (linearPhaseEnabled_)
+            linearPhase_.resetBand(row, band);
+    }
+}
+
+// Unless the FIR or STFT engine is in use, whose state is too big to keep a
+// copy of, the start of the block is processed from the same state with the
+// old settings and then the new, and crossfaded. Rather than working out
+// the new filters and curves, applyProgram copies the ones the program was
+// given ahead of time.
+int Assignment1Processor::applyPendingProgram(AudioSampleBuffer& buffer, const int numSamples,
+                                              const int numProcessedChannels)
+{
+    const ProgramBank::Program* program = programs_.beginApply();
+    if (program == nullptr)
+    {
+        programs_.endApply();
+        return 0;
+    }
+    ASSIGNMENT1_TRACE_SCOPE (trace_, "program", -1);
+
+    const int fadeLength = (linearPhaseEnabled_ || spectralEnabled_)
+                         ? 0 : jmin(numSamples, programFadeBuffer_.getNumSamples());
+    if (fadeLength > 0)
+    {
+        // Processing overwrites the input, so it is kept for the second go
+        for (int channel = 0; channel < numProcessedChannels; ++channel)
+            programFadeBuffer_.copyFrom(channel, 0, buffer.getReadPointer(channel), fadeLength);
+        saveProcessingState();
+        // The old settings are only heard fading out, so this pass is
+        // neither shown in the analyser nor timed as well as the real one
+        fadingOut_ = true;
+        performance_.setPaused(true);
+        processSegment(buffer, 0, fadeLength, numProcessedChannels);
+        performance_.setPaused(false);
+        fadingOut_ = false;
+        restoreProcessingState();
+        for (int channel = 0; channel < numProcessedChannels; ++channel)
+        {
+            programFadeBuffer_.copyFrom(numChannels + channel, 0, buffer.getReadPointer(channel), fadeLength);
+            buffer.copyFrom(channel, 0, programFadeBuffer_.getReadPointer(channel), fadeLength);
+        }
+    }
+
+    applyProgram(*program);
+    programs_.endApply();
+    programApplied_.set(1);
+
+    if (fadeLength > 0)
+    {
+        processSegment(buffer, 0, fadeLength, numProcessedChannels);
+        for (int channel = 0; channel < numProcessedChannels; ++channel)
+        {
+            buffer.applyGainRamp(channel, 0, fadeLength, 0.0f, 1.0f);
+            buffer.addFromWithRamp(channel, 0, programFadeBuffer_.getReadPointer(numChannels + channel),
+                                   fadeLength, 1.0f, 0.0f);
+        }
+    }
+    return fadeLength;
+}
+
+// Every program parameter is set, which also tells the editor. The filters
+// keep their state.
+void Assignment1Processor::applyProgram(const ProgramBank::Program& program)
+{
+    for (const int index : programParameters_)
+    {
+        if (index < (int) program.values.size())
+            setParameter(index, program.values[(size_t) index]);
+    }
+
+    // Tables made for another sample rate are left to updateFilter and
+    // updateCompressor to work out again
+    if (program.sampleRate != getSampleRate())
+        return;
+    for (auto& row : crossoverFilters_)
+    {
+        for (size_t i = 0; i < row.size() && i < program.filters.size(); ++i)
+            row[i]->copyCoefficientsFrom(program.filters[i]);
+    }
+    std::copy(program.curves.begin(), program.curves.begin() + jmin(program.curves.size(), curves_.size()),
+              curves_.begin());
+    programInstalled_ = true;
+}
+
+// Everything processSegment changes as it runs the crossover engine, apart
+// from the buffers. Doesn't allocate.
+void Assignment1Processor::saveProcessingState()
+{
+    size_t i = 0;
+    for (const auto& row : crossoverFilters_)
+        for (const auto& filter : row)
+            filterSnapshot_[i++] = *filter;
+    i = 0;
+    for (const auto& row : compressors_)
+        for (const auto& compressor : row)
+            envelopeSnapshot_[i++] = compressor->getEnvelope();
+    std::copy(bandStates_.begin(), bandStates_.end(), bandSnapshot_.begin());
+    if (highQuality_)
+        truePeakSnapshot_.copyStateFrom(truePeak_);
+}
+
+void Assignment1Processor::restoreProcessingState()
+{
+    size_t i = 0;
+    for (auto& row : crossoverFilters_)
+        for (auto& filter : row)
+            *filter = filterSnapshot_[i++];
+    i = 0;
+    for (auto& row : compressors_)
+        for (auto& compressor : row)
+            compressor->setEnvelope(envelopeSnapshot_[i++]);
+    std::copy(bandSnapshot_.begin(), bandSnapshot_.end(), bandStates_.begin());
+    if (highQuality_)
+        truePeak_.copyStateFrom(truePeakSnapshot_);
+}
+
+// Copy every band of the first channel (or the mid) to the analyser
+void Assignment1Processor::pushBandsToAnalyser(const bool compressed)
+{
+    ASSIGNMENT1_TIME_STAGE (performance_, PerformanceMonitor::kAnalysis);
+    for (int band = 0; band < numCompPerChannel; ++band)
+    {
+        if (bandStates_[band].active)
+            analyser_.pushBand(band, compressed, getBandPointer(0, band), segment_.numSamples);
+    }
+}
+
+// Run one stage of processSegment: job(0) ... job(numJobs-1). With shared
+// threads on, the jobs are spread over the process-wide DSPThreadPool;
+// otherwise they are run here, in order.
+void Assignment1Processor::runJobs(const StageJob job, const int numJobs)
+{
+    if (useThreadPool_ && numJobs > 1)
+    {
+        StageRun run = { this, job };
+        threadPool_.get()->run(&Assignment1Processor::runStageJob, &run, numJobs);
+    }
+    else
+    {
+        for (int i = 0; i < numJobs; ++i)
+            (this->*job)(i);
+    }
+}
+
+void Assignment1Processor::runStageJob(void* context, int index)
+{
+    // Worker threads are doing the audio thread's work
+    ASSIGNMENT1_REALTIME_SCOPE();
+    const StageRun* run = static_cast<const StageRun*>(context);
+    (run->processor->*(run->job))(index);
+}
+
+// Split one channel (or mid, side or sidechain channel) into all of its
+// bands
+void Assignment1Processor::splitJob(const int row)
+{
     const int numBands = numXOverPerChannel+1;
-    // Store the number of the channel that is currently being processed
-    int channel;
-    // Copy input audio to a new buffer (input buffer will be used for output)
-    AudioSampleBuffer input;
-    input.makeCopyOf(buffer);
-    // Stores output in an output buffer, then copies to the actual buffer.
-    // This was possibly implemented due to an early bug and could be
-    // refactored for improved memory efficiency.
-    AudioSampleBuffer output = AudioSampleBuffer(1, numSamples);
-    buffer.clear();
-
-    // Update parameters of all effects on each block. This seems excessive to
-    // perform in the processing block, but a function that is only called
-    // reliably on parameter changes wasn't found.
-    updateCompressor(getSampleRate());
-    updateFilter(getSampleRate());
-    // Go through each channel of audio that's passed in
-    for (channel = 0; channel < numInputChannels; ++channel)
+    AudioSampleBuffer& buffer = *segment_.buffer;
+    const int startSample = segment_.startSample;
+    const int numSamples = segment_.numSamples;
+
+    if (row >= segment_.numMainRows)
+    {
+        // The key is read straight from the host's sidechain channels and
+        // split with the same crossover settings
+        const int key = row - segment_.numMainRows;
+        const float* in = buffer.getReadPointer(getChannelIndexInProcessBlockBuffer(true, 1, key), startSample);
+        for (int band = 0; band < numBands; ++band)
+        {
+            if (bandStates_[band].compressed)
+                splitBand(numChannels + key, band, in, getBandPointer(numChannels + key, band), numSamples);
+        }
+    }
+    else if (midSideEnabled_)
+    {
+        // Channel 0 holds the mid bands and channel 1 the side bands. The
+        // encode (mid = (L + R) / 2, side = (L - R) / 2) is done by the
+        // first filter of each band as it reads the input.
+        const float* left = buffer.getReadPointer(0, startSample);
+        const float* right = buffer.getReadPointer(1, startSample);
+        const float rightGain = (row == 0) ? 0.5f : -0.5f;
+        for (int band = 0; band < numBands; ++band)
+        {
+            if (bandStates_[band].active)
+                splitBand(row, band, left, right, 0.5f, rightGain, getBandPointer(row, band), numSamples);
+        }
+    }
+    else
     {
         // in is an array of length numSamples which contains the audio for one channel
-        float* in = input.getWritePointer(channel);
-        float* out = output.getWritePointer(0);
+        const float* in = buffer.getReadPointer(row, startSample);
+        for (int band = 0; band < numBands; ++band)
+        {
+            if (bandStates_[band].active)
+                splitBand(row, band, in, getBandPointer(row, band), numSamples);
+        }
+    }
+}
 
-        // Apply each filter to create sub-bands
-        int i = 0;
-        int j = 0;
-        crossoverFilters_[channel][i]->applyFilter(in, out, numSamples);
-        // If using the Linkwitz Riley filter structure, apply the 2nd order
-        // butterworth twice to create a 4th order Linkwitz Riley filter
-        if(crossoverFilters_[channel][i]->linkwitzRileyActive()) {
-            crossoverFilters_[channel][i]->applyFilter(out, out, numSamples);
+// Compress every band of one group of linked channels. Linked channels share
+// one detector signal: the largest magnitude of any of their keys. Only
+// channels whose compressors have the same settings are linked (never mid
+// with side), so they compute the same gain.
+void Assignment1Processor::compressJob(const int groupIndex)
+{
+    const int numBands = numXOverPerChannel+1;
+    const int numSamples = segment_.numSamples;
+    const int numKeyChannels = segment_.numKeyChannels;
+    const int group = groupIndex * segment_.groupSize;
+    const int groupEnd = jmin(group + segment_.groupSize, segment_.numProcessedChannels);
+    // Each group has its own detector pointers and scratch, so groups can
+    // be compressed at the same time
+    const float** detectors = linkPointers_.data() + group;
+    float* linked = linkBuffer_.getWritePointer(group);
+
+    for (int band = 0; band < numBands; ++band)
+    {
+        const BandState& state = bandStates_[band];
+        if (! state.compressed)
+        {
+            // Offline, bands that are heard uncompressed are delayed along
+            // with the compressed ones (see below)
+            if (highQuality_ && state.active)
+            {
+                for (int channel = group; channel < groupEnd; ++channel)
+                    truePeak_.delay(channel * numBands + band, getBandPointer(channel, band), numSamples);
+            }
+            continue;
         }
-        // Apply compressor to filtered subband
-        compressors_[channel][j]->processSamples(output, output, numSamples, 0);
-        // Add subband to output block
-        for (int sample = 0; sample < numSamples; ++sample)
-            buffer.getWritePointer(channel)[sample] += output.getReadPointer(0)[sample];
-
-        // Clear the output block ready for the next subband
-        output.clear();
-        j = 1;
-        i = 1;
-        // Create band pass subbands by applying both low and high pass filters
-        // to the input. Then apply compressor as with the previous subband and
-        // add to the output
-        while(i < (numXOverPerChannel*2)-1) {
-            crossoverFilters_[channel][i]->applyFilter(in, out, numSamples);
-            if(crossoverFilters_[channel][i]->linkwitzRileyActive()) {
-                crossoverFilters_[channel][i]->applyFilter(out, out, numSamples);
+        for (int channel = group; channel < groupEnd; ++channel)
+        {
+            // A mono key drives every channel
+            detectors[channel - group] = (numKeyChannels > 0)
+                ? getBandPointer(numChannels + jmin(channel, numKeyChannels-1), band)
+                : getBandPointer(channel, band);
+        }
+        // Rendering offline, the detectors also see the peaks between
+        // samples. Each channel has its own interpolator for each band, even
+        // when channels share a key. The peaks come out
+        // TruePeakDetector::kLatency samples late, so the band is held back
+        // as much once its own key has been read, and the delay is reported
+        // as latency (see getEngineLatency).
+        if (highQuality_)
+        {
+            for (int channel = group; channel < groupEnd; ++channel)
+            {
+                float* peaks = truePeakBuffer_.getWritePointer(channel);
+                truePeak_.process(channel * numBands + band, detectors[channel - group], peaks, numSamples);
+                detectors[channel - group] = peaks;
             }
+            for (int channel = group; channel < groupEnd; ++channel)
+                truePeak_.delay(channel * numBands + band, getBandPointer(channel, band), numSamples);
+        }
+        const float* keySamples = detectors[0];
+        if (groupEnd - group > 1)
+        {
+            kernels_->maxMagnitude(linked, detectors, groupEnd - group, numSamples);
+            keySamples = linked;
+        }
+        for (int channel = group; channel < groupEnd; ++channel)
+        {
+            float* bandSamples = getBandPointer(channel, band);
+            compressors_[channel][band]->processSamples(keySamples, bandSamples, numSamples, state.mixStart, state.mix);
+        }
+    }
+}
 
-            crossoverFilters_[channel][i+1]->applyFilter(out, out, numSamples);
-            if(crossoverFilters_[channel][i+1]->linkwitzRileyActive()) {
-                crossoverFilters_[channel][i+1]->applyFilter(out, out, numSamples);
-            }
+// Sum the bands of one channel back into the host's buffer
+void Assignment1Processor::sumJob(const int channel)
+{
+    const int numBands = numXOverPerChannel+1;
+    AudioSampleBuffer& buffer = *segment_.buffer;
+    const int startSample = segment_.startSample;
+    const int numSamples = segment_.numSamples;
+    const float** bands = bandPointers_.data() + channel * numBands * 2;
+    // Rows of this channel's bands (both of them for mid/side)
+    const int firstRow = midSideEnabled_ ? 0 : channel;
+    const int endRow = midSideEnabled_ ? 2 : channel + 1;
 
-            compressors_[channel][j]->processSamples(output, output, numSamples, 0);
-            for (int sample = 0; sample < numSamples; ++sample)
-                buffer.getWritePointer(channel)[sample] += output.getReadPointer(0)[sample];
-            output.clear();
-            j++;
-            i+=2;
-        }
-        // Finally, apply the high pass to reate the final subband and compress
-        // as before
-        i = (numXOverPerChannel*2)-1;
-        crossoverFilters_[channel][i]->applyFilter(in, out, numSamples);
-        if(crossoverFilters_[channel][i]->linkwitzRileyActive()) {
-            crossoverFilters_[channel][i]->applyFilter(out, out, numSamples);
+    // Only the bands that are still audible are summed, faded if they're
+    // being soloed or muted
+    int numActive = 0;
+    for (int band = 0; band < numBands; ++band)
+    {
+        const BandState& state = bandStates_[band];
+        if (! state.active)
+            continue;
+        for (int row = firstRow; row < endRow; ++row)
+        {
+            if (state.levelStart != 1.0f || state.level != 1.0f)
+                bandBuffer_.applyGainRamp(row * numBands + band, 0, numSamples, state.levelStart, state.level);
+            bands[(row - firstRow) * numBands + numActive] = getBandPointer(row, band);
         }
-        compressors_[channel][j]->processSamples(output, output, numSamples, 0);
-        for (int sample = 0; sample < numSamples; ++sample)
-            buffer.getWritePointer(channel)[sample] += output.getReadPointer(0)[sample];
-        output.clear();
-        j = 0;
+        ++numActive;
     }
-    // Go through the remaining channels. In case we have more outputs
-    // than inputs, or there aren't enough filters, we'll clear any
-    // remaining output channels (which could otherwise contain garbage)
-    while(channel < numOutputChannels)
+
+    if (midSideEnabled_)
+    {
+        // Decoding back to left and right is part of the sum
+        kernels_->sumBandsMidSide(buffer.getWritePointer(0, startSample), buffer.getWritePointer(1, startSample),
+                                  bands, bands + numBands, numActive, numSamples);
+    }
+    else
+    {
+        kernels_->sumBands(buffer.getWritePointer(channel, startSample), bands, numActive, numSamples);
+    }
+}
+
+void Assignment1Processor::spectralJob(const int channel)
+{
+    spectral_.process(channel, segment_.buffer->getWritePointer(channel, segment_.startSample), segment_.numSamples);
+}
+
+// Filter one channel of input into a single sub-band. The lowest band is a
+// single low pass, the highest a single high pass, and every band in between
+// a high pass followed by a low pass.
+void Assignment1Processor::splitBand(const int channel, const int band, const float* in, float* out, const int numSamples)
+{
+    splitBand(channel, band, in, nullptr, 1.0f, 0.0f, out, numSamples);
+}
+
+// Split gainA * inA + gainB * inB into a sub-band. The mix is done by the
+// first filter as it reads its input. inB may be null to split inA alone.
+void Assignment1Processor::splitBand(const int channel, const int band, const float* inA, const float* inB,
+                                     const float gainA, const float gainB, float* out, const int numSamples)
+{
+    // The linear-phase crossover makes each band with a single FIR filter
+    if(linearPhaseEnabled_) {
+        if(inB == nullptr)
+            linearPhase_.processBand(channel, band, inA, out, numSamples);
+        else
+            linearPhase_.processBandMix(channel, band, inA, inB, gainA, gainB, out, numSamples);
+        return;
+    }
+    const int numBands = numXOverPerChannel+1;
+    const int first = (band == 0) ? 0 : (band*2)-1;
+    const int last = (band == numBands-1) ? (band*2)-1 : band*2;
+    if (inB == nullptr)
+        crossoverFilters_[channel][first]->applyFilter(inA, out, numSamples);
+    else
+        crossoverFilters_[channel][first]->applyFilterMix(inA, inB, gainA, gainB, out, numSamples);
+    for (int i = first + 1; i <= last; ++i)
     {
-        buffer.clear (channel++, 0, buffer.getNumSamples());
+        // Linkwitz Riley filters run both of their butterworth sections in
+        // this one call
+        crossoverFilters_[channel][i]->applyFilter(out, out, numSamples);
     }
 }
 
@@ -342,60 +1066,523 @@ bool Assignment1Processor::hasEditor() const
     return true; // (change this to false if you choose to not supply an editor)
 }
 
-AudioProcessorEditor* Assignment1Processor::createEditor() { return new GenericEditor (*this); }
+AudioProcessorEditor* Assignment1Processor::createEditor() { return new Assignment1Editor (*this); }
 
 
 //==============================================================================
-// Can be used to persist states between instances. Removed for simplicity.
+// Values are saved normalised and found again by parameter ID, so state
+// saved by a version with fewer parameters still loads
+static void addStateValue(XmlElement& parent, const AudioProcessorParameter* parameter, const float value)
+{
+    if (const AudioProcessorParameterWithID* withID = dynamic_cast<const AudioProcessorParameterWithID*>(parameter))
+    {
+        XmlElement* element = parent.createNewChildElement("PARAM");
+        element->setAttribute("id", withID->paramID);
+        element->setAttribute("value", (double) value);
+    }
+}
+
+// The index of the parameter with the ID, or -1
+static int findStateParameter(const OwnedArray<AudioProcessorParameter>& params, const String& paramID)
+{
+    for (int i = 0; i < params.size(); ++i)
+    {
+        const AudioProcessorParameterWithID* withID = dynamic_cast<const AudioProcessorParameterWithID*>(params[i]);
+        if (withID != nullptr && withID->paramID == paramID)
+            return i;
+    }
+    return -1;
+}
+
+// Every parameter, then the program parameters of each program, and which
+// program is current
 void Assignment1Processor::getStateInformation (MemoryBlock& destData)
 {
+    XmlElement state ("ASSIGNMENT1");
+    state.setAttribute ("program", programs_.getCurrentProgram());
+    const OwnedArray<AudioProcessorParameter>& params = getParameters();
+    for (int i = 0; i < params.size(); ++i)
+        addStateValue(state, params[i], getParameter(i));
+
+    for (int p = 0; p < programs_.getNumPrograms(); ++p)
+    {
+        const ProgramBank::Program* program = programs_.getProgram(p);
+        XmlElement* element = state.createNewChildElement("PROGRAM");
+        element->setAttribute("name", program->name);
+        for (const int index : programParameters_)
+            addStateValue(*element, params[index], program->values[(size_t) index]);
+    }
+    copyXmlToBinary (state, destData);
 }
 
+// The programs are replaced before the parameters are set, and the saved
+// program is made current without being applied, as the parameters may have
+// been changed after it was picked
 void Assignment1Processor::setStateInformation (const void* data, int sizeInBytes)
 {
+    std::unique_ptr<XmlElement> state (getXmlFromBinary (data, sizeInBytes));
+    if (state == nullptr || ! state->hasTagName ("ASSIGNMENT1"))
+        return;
+    const OwnedArray<AudioProcessorParameter>& params = getParameters();
+
+    int p = 0;
+    forEachXmlChildElementWithTagName (*state, element, "PROGRAM")
+    {
+        const ProgramBank::Program* old = programs_.getProgram(p);
+        if (old == nullptr)
+            break;
+        ProgramBank::Program* program = new ProgramBank::Program();
+        program->name = element->getStringAttribute("name", old->name);
+        program->values = old->values;
+        forEachXmlChildElementWithTagName (*element, value, "PARAM")
+        {
+            const int index = findStateParameter(params, value->getStringAttribute("id"));
+            if (std::find(programParameters_.begin(), programParameters_.end(), index) != programParameters_.end())
+                program->values[(size_t) index] = jlimit(0.0f, 1.0f, (float) value->getDoubleAttribute("value"));
+        }
+        prepareProgram(*program, getSampleRate());
+        programs_.replaceProgram(p++, program);
+    }
+
+    forEachXmlChildElementWithTagName (*state, value, "PARAM")
+    {
+        const int index = findStateParameter(params, value->getStringAttribute("id"));
+        if (index >= 0)
+            setParameterNotifyingHost(index, jlimit(0.0f, 1.0f, (float) value->getDoubleAttribute("value")));
+    }
+    programs_.setCurrentWithoutApplying(state->getIntAttribute("program", programs_.getCurrentProgram()));
+    updateHostDisplay();
 }
 
 //==============================================================================
 // Update the coefficients of the parametric equaliser filter
 void Assignment1Processor::updateFilter(float sampleRate)
 {
-    // Iterate over each filter object and apply relevant parameters from the
-    // UI
-    for(int i = 0; i < numChannels; i++) {
+    bool changed = false;
+    // Iterate over each filter object (including the sidechain's) and apply
+    // relevant parameters from the UI
+    for(int i = 0; i < numCrossoverFilters_; i++) {
         int j = 0;
         int k = 0;
-        crossoverFilters_[i][j]->makeCrossover(*crossoverFreq[k], sampleRate, true, false);
+        changed |= crossoverFilters_[i][j]->makeCrossover(*crossoverFreq[k], sampleRate, true, false);
         j = 1;
         k = 1;
         while(j < (numXOverPerChannel*2)-1) {
-            crossoverFilters_[i][j]->makeCrossover(*crossoverFreq[k-1], sampleRate, true, true);
-            crossoverFilters_[i][j+1]->makeCrossover(*crossoverFreq[k], sampleRate, true, false);
+            changed |= crossoverFilters_[i][j]->makeCrossover(*crossoverFreq[k-1], sampleRate, true, true);
+            changed |= crossoverFilters_[i][j+1]->makeCrossover(*crossoverFreq[k], sampleRate, true, false);
             j+=2;
             k++;
         }
         j = (numXOverPerChannel*2)-1;
-        crossoverFilters_[i][j]->makeCrossover(*crossoverFreq[k-1], sampleRate, true, true);
+        changed |= crossoverFilters_[i][j]->makeCrossover(*crossoverFreq[k-1], sampleRate, true, true);
+    }
+    // New FIR filters are only asked for when a frequency changes, and not
+    // at all while they're switched out
+    if(linearPhaseEnabled_) {
+        for(int i = 0; i < numXOverPerChannel; i++)
+            crossoverFreqValues_[i] = *crossoverFreq[i];
+        changed |= linearPhase_.setCrossoverFrequencies(crossoverFreqValues_.data());
+    }
+
+    // Mark coefficient changes in the trace so they can be lined up with
+    // any latency spikes they cause
+    if(changed)
+        ASSIGNMENT1_TRACE_INSTANT (trace_, "updateFilter", -1);
+
+    // Every channel's filters are the same, so the analyser is given the
+    // first channel's, and only when they change
+    changed |= programInstalled_;
+    programInstalled_ = false;
+    if(analyser_.isActive() && (changed || analyser_.needsCrossover()) && numCrossoverFilters_ > 0) {
+        const double* coefficients[SpectrumAnalyser::kMaxFilters];
+        int numStages[SpectrumAnalyser::kMaxFilters];
+        const int numFilters = jmin((int) SpectrumAnalyser::kMaxFilters, (int) crossoverFilters_[0].size());
+        for(int i = 0; i < numFilters; i++) {
+            coefficients[i] = crossoverFilters_[0][i]->getCoefficients();
+            numStages[i] = crossoverFilters_[0][i]->getNumStages();
+        }
+        analyser_.setCrossover(coefficients, numStages, numFilters);
+    }
+}
+
+// Switch engines between blocks. The FIR filters and the STFT start from
+// silence each time they are switched in, and the host is told about the
+// change in latency from the message thread.
+void Assignment1Processor::updateEngine()
+{
+    const bool linearPhase = *linearPhaseActive;
+    const bool spectral = *spectralActive;
+    // The pool is created by the message thread, the first time it sees
+    // it wanted (see timerCallback). Until it exists every stage runs here.
+    useThreadPool_ = *sharedThreadsActive && threadPool_.get() != nullptr;
+    // Mid/side only makes sense for a stereo pair. It doesn't change the
+    // latency, so switching only needs the compressor settings swapping,
+    // which updateCompressor does.
+    midSideEnabled_ = *midSideActive && numChannels == 2;
+    // The true peak detectors start from silence rather than from wherever
+    // they were left the last time the host rendered offline
+    const bool highQuality = isNonRealtime();
+    if(highQuality && ! highQuality_)
+        truePeak_.reset();
+    bool latencyChanged = highQuality != highQuality_;
+    highQuality_ = highQuality;
+    if(linearPhase != linearPhaseEnabled_ || spectral != spectralEnabled_) {
+        if(linearPhase && ! linearPhaseEnabled_)
+            linearPhase_.reset();
+        if(spectral && ! spectralEnabled_)
+            spectral_.reset();
+        linearPhaseEnabled_ = linearPhase;
+        spectralEnabled_ = spectral;
+        latencyChanged = true;
+        ASSIGNMENT1_TRACE_INSTANT (trace_, "updateEngine", -1);
     }
+    // The sidechain's filters aren't run while it's off, so they start again
+    // from silence when it's switched back on rather than from wherever
+    // they were left
+    const bool keyed = *sidechainActive && numKeyChannels_ > 0;
+    if(keyed && ! keyed_)
+        for(int band = 0; band < numCompPerChannel; band++)
+            resetBand(band, numChannels, numCrossoverFilters_);
+    keyed_ = keyed;
+    if(latencyChanged)
+        pendingLatency_.set(getEngineLatency());
+}
+
+int Assignment1Processor::getLinkGroupSize(const int numProcessedChannels) const
+{
+    // Mid and side have compressors of their own, with their own settings,
+    // so linking them would make one follow the other's key
+    if (midSideEnabled_)
+        return 1;
+    switch (channelLink->getIndex())
+    {
+        case kLinkPairs:    return 2;
+        case kLinkAll:      return jmax(1, numProcessedChannels);
+        default:            return 1;
+    }
+}
+
+int Assignment1Processor::getEngineLatency() const
+{
+    if(spectralEnabled_)
+        return spectral_.getLatency();
+    // Offline, the bands are held back to line up with their true peaks
+    const int truePeakLatency = highQuality_ ? (int) TruePeakDetector::kLatency : 0;
+    return (linearPhaseEnabled_ ? linearPhase_.getLatency() : 0) + truePeakLatency;
+}
+
+// Every recursive part of the plugin forgets where it started exponentially,
+// so the warm-up is enough time constants of the slowest of them to get
+// within tolerance
+int Assignment1Processor::getWarmUpSamples(const double tolerance)
+{
+    const double sampleRate = getSampleRate();
+    const double numTimeConstants = std::log(1.0 / jlimit(1.0e-12, 1.0, tolerance));
+
+    // Compressor ballistics: the attack and release times are time constants
+    // in ms. An auto release can be up to twice the release time, and can't
+    // settle before the crest factor it follows has, so the crest
+    // detectors' time constant is added to it.
+    const bool autoRelease = *autoReleaseActive;
+    const double releaseScale = autoRelease ? 2.0 : 1.0;
+    double slowest = 0;
+    for(int j = 0; j < numCompPerChannel; j++) {
+        slowest = jmax(slowest, (double) *compressorAttack[j], releaseScale * *compressorRelease[j]);
+        if(midSideEnabled_)
+            slowest = jmax(slowest, (double) *sideAttack[j], releaseScale * *sideRelease[j]);
+    }
+    if(autoRelease)
+        slowest += Compressor::kCrestTimeMs;
+    slowest *= 0.001 * sampleRate;
+
+    // The crossovers are built from Butterworth sections, whose poles decay
+    // with a time constant of sqrt(2) / w0, so the lowest crossover is the
+    // slowest. Linkwitz-Riley filters repeat each pole, which then decays as
+    // t.exp(-t / tau); a couple of extra time constants cover that.
+    float lowest = *crossoverFreq[0];
+    for(int k = 1; k < numXOverPerChannel; k++)
+        lowest = jmin(lowest, (float) *crossoverFreq[k]);
+    slowest = jmax(slowest, std::sqrt(2.0) * sampleRate / (2.0 * double_Pi * lowest));
+
+    // The FIR and STFT engines forget their input completely after their
+    // own length, which is at most twice their latency
+    return (int) std::ceil(slowest * (numTimeConstants + 2.0)) + 2 * getEngineLatency();
+}
+
+int Assignment1Processor::getChunkAlignment(const int blockSize) const
+{
+    // The compressors restart their control rate intervals on every block,
+    // and the STFT's hops divide its frame
+    if(! spectralEnabled_)
+        return blockSize;
+    int a = blockSize, b = spectral_.getLatency();
+    while(b != 0) {
+        const int r = a % b;
+        a = b;
+        b = r;
+    }
+    return blockSize / a * spectral_.getLatency();
+}
+
+// Bytes held by a vector, or by an AudioSampleBuffer (its channel pointers,
+// the samples and JUCE's 32 bytes of padding)
+template <typename T>
+static size_t getVectorMemory(const std::vector<T>& v)
+{
+    return sizeof(T) * v.capacity();
+}
+
+static size_t getBufferMemory(const AudioSampleBuffer& buffer)
+{
+    if(buffer.getNumChannels() == 0)
+        return 0;
+    return sizeof(float*) * (size_t) (buffer.getNumChannels() + 1)
+         + sizeof(float) * (size_t) buffer.getNumChannels() * (size_t) buffer.getNumSamples() + 32;
+}
+
+size_t Assignment1Processor::getMemoryUsage() const
+{
+    size_t bytes = sizeof(*this);
+
+    // Filters and compressors are allocated one by one
+    bytes += getVectorMemory(crossoverFilters_);
+    for(const auto& row : crossoverFilters_)
+        bytes += getVectorMemory(row) + sizeof(CrossoverFilter) * row.size();
+    bytes += getVectorMemory(compressors_);
+    for(const auto& row : compressors_) {
+        bytes += getVectorMemory(row);
+        for(const auto& compressor : row)
+            bytes += compressor != nullptr ? compressor->getMemoryUsage() : 0;
+    }
+    bytes += getVectorMemory(curves_);
+
+    // Parameter pointers
+    bytes += getVectorMemory(crossoverFreq) + getVectorMemory(compressorThresh) + getVectorMemory(compressorRatio)
+           + getVectorMemory(compressorActive) + getVectorMemory(compressorGain) + getVectorMemory(compressorAttack)
+           + getVectorMemory(compressorRelease) + getVectorMemory(compressorKnee);
+    bytes += getVectorMemory(sideActive) + getVectorMemory(sideThresh) + getVectorMemory(sideRatio)
+           + getVectorMemory(sideGain) + getVectorMemory(sideAttack) + getVectorMemory(sideRelease)
+           + getVectorMemory(sideKnee);
+    bytes += getVectorMemory(bandSolo) + getVectorMemory(bandMute) + getVectorMemory(bandBypass)
+           + getVectorMemory(bandStates_);
+
+    // Processing buffers and scratch
+    bytes += getBufferMemory(bandBuffer_) + getBufferMemory(compressorScratch_) + getBufferMemory(linkBuffer_)
+           + getBufferMemory(truePeakBuffer_) + truePeak_.getMemoryUsage();
+    bytes += getVectorMemory(bandPointers_) + getVectorMemory(linkPointers_) + getVectorMemory(crossoverFreqValues_);
+
+    // Alternative engines, metering and instrumentation
+    bytes += linearPhase_.getMemoryUsage() + spectral_.getMemoryUsage() + loudness_.getMemoryUsage()
+             + analyser_.getMemoryUsage();
+    // The queue, and the space its events are sorted into
+    bytes += automation_.getMemoryUsage() + sizeof(AutomationEvent) * (size_t) automation_.getCapacity();
+    bytes += parameterChanges_.getMemoryUsage() + automatedParameters_.getMemoryUsage()
+           + sizeof(int) * (size_t) automatedParameters_.getNumParameters();
+    // Programs, and what the program crossfade keeps
+    bytes += programs_.getMemoryUsage() + getBufferMemory(programFadeBuffer_) + getVectorMemory(filterSnapshot_)
+           + getVectorMemory(envelopeSnapshot_) + getVectorMemory(bandSnapshot_) + truePeakSnapshot_.getMemoryUsage();
+    bytes += trace_.getMemoryUsage();
+    return bytes;
+}
+
+void Assignment1Processor::timerCallback()
+{
+    if(*sharedThreadsActive && threadPoolHolder_ == nullptr) {
+        threadPoolHolder_.reset(new SharedResourcePointer<DSPThreadPool>());
+        threadPool_.set(&threadPoolHolder_->get());
+    }
+    const int latency = pendingLatency_.get();
+    if(latency != getLatencySamples())
+        setLatencySamples(latency);
+    if(designWanted_.exchange(0) != 0)
+        linearPhase_.designKernels();
+    // Queued automation is passed on as it would come from the editor, so
+    // that a host can record it
+    const int numAutomated = automatedParameters_.pop(automatedIndices_, automatedParameters_.getNumParameters());
+    for(int i = 0; i < numAutomated; i++) {
+        const int index = automatedIndices_[i];
+        beginParameterChangeGesture(index);
+        sendParamChangeMessageToListeners(index, getParameter(index));
+        endParameterChangeGesture(index);
+    }
+    // After a program change the host has every parameter to read again
+    if(programApplied_.exchange(0) != 0)
+        updateHostDisplay();
 }
 void Assignment1Processor::updateCompressor(float sampleRate)
 {
+    bool changed = false;
+    // An interval of 1 computes the gain at audio rate, as is always done
+    // when rendering offline
+    const int interval = (*controlRateActive && ! highQuality_) ? (int) *controlRateInterval : 1;
     // Iterate over each compressor object and apply relevant parameters from the
     // UI
     for(int i = 0; i < numChannels; i++) {
+        // In mid/side mode the second channel's compressors work on the side
+        // signal and have their own settings
+        const bool side = midSideEnabled_ && i == 1;
         for(int j = 0; j < numCompPerChannel; j++) {
-            compressors_[i][j]->makeCompressor(
+            compressors_[i][j]->setCurve(curves_[side ? numCompPerChannel + j : j]);
+            // The RMS of an interval tracks the audio rate gain far more
+            // closely than its peak (see Tests/ControlRateTests.cpp)
+            compressors_[i][j]->setControlRate(interval, Compressor::kExponentialInterpolation, Compressor::kBlockRMS);
+            compressors_[i][j]->autoTime = *autoReleaseActive;
+            changed |= compressors_[i][j]->makeCompressor(
+                    sampleRate,
+                    side ? *sideActive[j] : *compressorActive[j],
+                    side ? *sideRatio[j] : *compressorRatio[j],
+                    side ? *sideThresh[j] : *compressorThresh[j],
+                    side ? *sideAttack[j] : *compressorAttack[j],
+                    side ? *sideRelease[j] : *compressorRelease[j],
+                    side ? *sideGain[j] : *compressorGain[j],
+                    side ? *sideKnee[j] : *compressorKnee[j]
+                );
+        }
+    }
+    if(spectralEnabled_)
+        updateSpectral(sampleRate);
+    if(changed)
+        ASSIGNMENT1_TRACE_INSTANT (trace_, "updateCompressor", -1);
+}
+
+// Give each band of the spectral engine the settings of the crossover band
+// its centre frequency falls in, so the existing controls shape the curve
+// across all of the spectral bands
+void Assignment1Processor::updateSpectral(float sampleRate)
+{
+    spectral_.setNumBands((int) *spectralBands);
+    for(int band = 0; band < spectral_.getNumBands(); band++) {
+        const float frequency = spectral_.getBandFrequency(band);
+        int j = 0;
+        while(j < numXOverPerChannel && frequency >= *crossoverFreq[j])
+            j++;
+        for(int i = 0; i < numChannels; i++) {
+            spectral_.getCompressor(i, band).makeCompressor(
                     sampleRate,
                     *compressorActive[j],
                     *compressorRatio[j],
                     *compressorThresh[j],
                     *compressorAttack[j],
                     *compressorRelease[j],
-                    *compressorGain[j]
+                    *compressorGain[j],
+                    *compressorKnee[j]
                 );
         }
     }
 }
 
+//==============================================================================
+// Programs store normalised values, as setParameter takes them
+static void setProgramValue(ProgramBank::Program& program, const AudioProcessorParameter* parameter, const float value)
+{
+    program.values[(size_t) parameter->getParameterIndex()] = value;
+}
+
+static void setProgramValue(ProgramBank::Program& program, const AudioParameterFloat* parameter, const float value)
+{
+    setProgramValue(program, (const AudioProcessorParameter*) parameter, parameter->range.convertTo0to1(value));
+}
+
+static float getProgramValue(const ProgramBank::Program& program, const AudioParameterFloat* parameter)
+{
+    return parameter->range.convertFrom0to1(program.values[(size_t) parameter->getParameterIndex()]);
+}
+
+// The factory programs are the defaults with the crossovers and bands set
+// as below. Bands with a ratio above 1 are switched on.
+void Assignment1Processor::createFactoryPrograms()
+{
+    struct FactoryProgram
+    {
+        const char* name;
+        float crossover[3];
+        float band[4][6];       // Threshold, ratio, attack, release, knee, gain
+    };
+    static const FactoryProgram factoryPrograms[] =
+    {
+        { "Gentle Glue",   { 150, 1500, 6000 },
+          { { -24, 2, 20, 200, 6, 1 }, { -24, 2, 15, 150, 6, 1 }, { -24, 2, 10, 120, 6, 1 }, { -24, 2, 5, 100, 6, 1 } } },
+        { "Mastering",     { 120, 800, 5000 },
+          { { -18, 1.5f, 30, 300, 12, 1 }, { -18, 1.5f, 20, 200, 12, 1 }, { -20, 1.5f, 10, 150, 12, 1 }, { -20, 1.5f, 5, 100, 12, 1 } } },
+        { "Vocal Control", { 250, 2000, 7000 },
+          { { -30, 2, 20, 150, 6, 0 }, { -24, 3, 10, 100, 6, 2 }, { -24, 3, 5, 80, 6, 2 }, { -30, 6, 1, 50, 3, 0 } } },
+        { "Drum Bus",      { 100, 1000, 6000 },
+          { { -20, 4, 10, 100, 3, 3 }, { -20, 4, 5, 80, 3, 3 }, { -18, 3, 2, 60, 3, 2 }, { -18, 2, 1, 50, 3, 1 } } },
+        { "De-Esser",      { 200, 3000, 6000 },
+          { { 0, 1, 10, 100, 0, 0 }, { 0, 1, 10, 100, 0, 0 }, { 0, 1, 10, 100, 0, 0 }, { -36, 8, 0.5f, 50, 6, 0 } } }
+    };
+    jassert (numXOverPerChannel == 3 && numCompPerChannel == 4);
+
+    // Programs only set the crossovers and the compressors, main and side.
+    // Engine, metering, linking and audition settings are left as they are.
+    for (int k = 0; k < numXOverPerChannel; ++k)
+        programParameters_.push_back(crossoverFreq[k]->getParameterIndex());
+    for (int j = 0; j < numCompPerChannel; ++j)
+    {
+        const AudioProcessorParameter* bandParameters[] =
+        {
+            compressorActive[j], compressorThresh[j], compressorRatio[j], compressorGain[j],
+            compressorAttack[j], compressorRelease[j], compressorKnee[j],
+            sideActive[j], sideThresh[j], sideRatio[j], sideGain[j], sideAttack[j], sideRelease[j], sideKnee[j]
+        };
+        for (const AudioProcessorParameter* parameter : bandParameters)
+            programParameters_.push_back(parameter->getParameterIndex());
+    }
+
+    programs_.addProgram(createProgram("Default"));
+    for (const FactoryProgram& factory : factoryPrograms)
+    {
+        ProgramBank::Program* program = createProgram(factory.name);
+        for (int k = 0; k < jmin(numXOverPerChannel, 3); ++k)
+            setProgramValue(*program, crossoverFreq[k], factory.crossover[k]);
+        for (int j = 0; j < jmin(numCompPerChannel, 4); ++j)
+        {
+            const float* band = factory.band[j];
+            setProgramValue(*program, compressorActive[j], band[1] > 1 ? 1.0f : 0.0f);
+            setProgramValue(*program, compressorThresh[j], band[0]);
+            setProgramValue(*program, compressorRatio[j], band[1]);
+            setProgramValue(*program, compressorAttack[j], band[2]);
+            setProgramValue(*program, compressorRelease[j], band[3]);
+            setProgramValue(*program, compressorKnee[j], band[4]);
+            setProgramValue(*program, compressorGain[j], band[5]);
+        }
+        programs_.addProgram(program);
+    }
+    for (int i = 0; i < kNumUserPrograms; ++i)
+        programs_.addProgram(createProgram("User " + String(i + 1)));
+}
+
+ProgramBank::Program* Assignment1Processor::createProgram(const String& name)
+{
+    ProgramBank::Program* program = new ProgramBank::Program();
+    program->name = name;
+    for (int i = 0; i < getNumParameters(); ++i)
+        program->values.push_back(getParameter(i));
+    return program;
+}
+
+// Made exactly as updateFilter and updateCompressor would make them from
+// the same parameter values, so that the comparisons in makeCrossover and
+// GainCurve::setParameters find nothing to do once they're copied in
+void Assignment1Processor::prepareProgram(ProgramBank::Program& program, const double sampleRate) const
+{
+    program.sampleRate = sampleRate;
+    program.filters.assign(numXOverPerChannel * 2, CrossoverFilter(false, true));
+    program.curves.assign(numCompPerChannel * 2, GainCurve());
+    if (sampleRate < 1)
+        return;
+    // Each crossover frequency makes a low pass then a high pass
+    for (int i = 0; i < numXOverPerChannel * 2; ++i)
+        program.filters[i].makeCrossover(getProgramValue(program, crossoverFreq[i / 2]), (int) sampleRate, true, (i & 1) != 0);
+    for (int j = 0; j < numCompPerChannel; ++j)
+    {
+        program.curves[j].setParameters(GainCurve::kCompressor, getProgramValue(program, compressorThresh[j]),
+                                        getProgramValue(program, compressorRatio[j]), getProgramValue(program, compressorKnee[j]));
+        program.curves[numCompPerChannel + j].setParameters(GainCurve::kCompressor, getProgramValue(program, sideThresh[j]),
+                                        getProgramValue(program, sideRatio[j]), getProgramValue(program, sideKnee[j]));
+    }
+}
+
 //==============================================================================
 // This creates new instances of the plugin..
 AudioProcessor* JUCE_CALLTYPE createPluginFilter()
@@ -31,17 +31,29 @@
 #define __PLUGINPROCESSOR_H_4693CB6E__
 
 #define _USE_MATH_DEFINES
-#include "../JuceLibraryCode/JuceHeader.h"
+#include "JuceHeader.h"
 #include "CrossoverFilter.h"
 #include "Compressor.h"
-#include "GenericEditor.h"
+#include "LinearPhaseCrossover.h"
+#include "SpectralMultiband.h"
+#include "AutomationQueue.h"
+#include "ParameterChangeQueue.h"
+#include "DSPThreadPool.h"
+#include "LoudnessMeter.h"
+#include "TruePeakDetector.h"
+#include "SpectrumAnalyser.h"
+#include "PerformanceMonitor.h"
+#include "TraceRecorder.h"
+#include "RealtimeSafety.h"
+#include "ProgramBank.h"
 #include <vector>
 #include <array>
 
 //==============================================================================
 /**
 */
-class Assignment1Processor  : public AudioProcessor
+class Assignment1Processor  : public AudioProcessor,
+                              private Timer
 {
 public:
     //==============================================================================
@@ -53,6 +65,7 @@ public:
     void releaseResources();
 
     void processBlock (AudioSampleBuffer& buffer, MidiBuffer& midiMessages);
+    bool isBusesLayoutSupported (const BusesLayout& layouts) const;
 
     //==============================================================================
     AudioProcessorEditor* createEditor();
@@ -61,11 +74,14 @@ public:
     //==============================================================================
     const String getName() const;
 
+    // Every change to a parameter comes through here, so it also marks the
+    // parameter in getParameterChanges() for the editor
+    void setParameter (int index, float newValue) override;
+
     /*
     int getNumParameters();
 
     float getParameter (int index);
-    void setParameter (int index, float newValue);
 
     const String getParameterName (int index);
     const String getParameterText (int index);
@@ -87,8 +103,12 @@ public:
     void setCurrentProgram (int index);
     const String getProgramName (int index);
     void changeProgramName (int index, const String& newName);
+    // Replaces a program with the current settings, keeping its name. Call
+    // from the message thread.
+    void storeProgram (int index);
 
     //==============================================================================
+    // The parameters, every program and the current program
     void getStateInformation (MemoryBlock& destData);
     void setStateInformation (const void* data, int sizeInBytes);
 
@@ -108,11 +128,146 @@ public:
         kNumParameters
     };
 
+    // Largest main bus supported, enough for 7th order ambisonics
+    enum { kMaxChannels = 64 };
+
+    // Length of the fade when a band is soloed, muted or bypassed
+    enum { kBandFadeMs = 10 };
+
+    // Longest crossfade from one program to the next, and the number of
+    // empty user programs after the factory ones
+    enum { kProgramFadeMs = 10, kNumUserPrograms = 4 };
+    // Rate at which the message thread picks up the audio thread's requests
+    enum { kMessagePollHz = 50 };
+
+    // How the compressors of different channels share level detection. Mid
+    // and side are never linked.
+    enum ChannelLink
+    {
+        kLinkOff = 0,   // Every channel has its own detector
+        kLinkPairs,     // Channels 1+2, 3+4... share one (e.g. L/R, Ls/Rs)
+        kLinkAll        // Every channel shares one
+    };
+
     float centreFrequency_, q_, gainDecibels_;
     bool compressorONOFF = false;
+
+    // Timing counters for each stage of processBlock. Safe to read from any
+    // thread (see PerformanceMonitor::getSnapshot).
+    PerformanceMonitor& getPerformanceMonitor() { return performance_; }
+
+    // Write a Chrome trace of every instance in this process to a file (see
+    // TraceWriter). Call from the message thread.
+    bool startTracing(const File& file) { return traceWriter_->startWriting(file); }
+    void stopTracing() { traceWriter_->stopWriting(); }
+
+    // Name of the instruction set variant of the DSP kernels in use, for
+    // benchmarking
+    const char* getKernelName() const { return kernels_ != nullptr ? kernels_->name : "none"; }
+
+    // Queue a change to a parameter (normalised value, as for setParameter)
+    // that should take effect sampleOffset samples into the next block, or
+    // a later one if the offset is past its end. The host is told once it
+    // has been applied. Call from one thread only, e.g. the host wrapper or
+    // a sequencer, ahead of the block. Returns false if the queue is full.
+    bool queueParameterChange(const int parameterIndex, const float value, const int sampleOffset)
+    {
+        return automation_.push({ sampleOffset, parameterIndex, value });
+    }
+
+    // Samples of input a fresh instance has to be run on before its output
+    // matches that of an instance that has been running all along. tolerance
+    // is the fraction of any difference in filter and compressor state that
+    // may be left over. Depends on the current settings; call after
+    // prepareToPlay. Used to pre-roll chunks of an offline render.
+    int getWarmUpSamples(const double tolerance);
+    // Pre-rolls have to start on a multiple of this many samples for their
+    // blocks (and STFT frames) to line up with an uninterrupted render
+    int getChunkAlignment(const int blockSize) const;
+
+    // Bytes of memory held by this instance: the object itself and
+    // everything it has allocated for processing (not counting the
+    // parameter objects, which belong to AudioProcessor). Call from the
+    // message thread.
+    size_t getMemoryUsage() const;
+
+    // Loudness and true peak of the output, measured while the "Loudness
+    // Meter" parameter is on. Readings can be taken from any thread.
+    LoudnessMeter& getLoudnessMeter() { return loudness_; }
+
+    // Spectra of the bands of the first channel, while an editor has it
+    // active
+    SpectrumAnalyser& getSpectrumAnalyser() { return analyser_; }
+
+    // Parameters changed since the editor last looked. Only the editor pops
+    // from it.
+    ParameterChangeQueue& getParameterChanges() { return parameterChanges_; }
 private:
+    // Polls what the audio thread has left for the message thread, which it
+    // can't post without taking the message queue's lock: creates the
+    // shared thread pool once it's switched on, reports a change of latency,
+    // applied automation and program changes to the host and designs FIR
+    // filters
+    void timerCallback() override;
+    // Switches between the crossover and spectral engines, and the sidechain
+    // on and off
+    void updateEngine();
     void updateFilter(float sampleRate);
     void updateCompressor(float sampleRate);
+    void updateSpectral(float sampleRate);
+    // Number of consecutive channels whose detectors are linked, 1 in
+    // mid/side mode
+    int getLinkGroupSize(const int numProcessedChannels) const;
+    // Delay added by the engine currently in use, and by true peak
+    // detection in offline quality mode, in samples
+    int getEngineLatency() const;
+    void processSegment(AudioSampleBuffer& buffer, const int startSample, const int numSamples,
+                        const int numProcessedChannels);
+    // Stages of processSegment, one job per channel (or group of linked
+    // channels). Jobs of the same stage can run at the same time.
+    typedef void (Assignment1Processor::*StageJob) (const int index);
+    struct StageRun
+    {
+        Assignment1Processor* processor;
+        StageJob job;
+    };
+    void runJobs(const StageJob job, const int numJobs);
+    static void runStageJob(void* context, int index);
+    void splitJob(const int row);
+    void compressJob(const int groupIndex);
+    void sumJob(const int channel);
+    void spectralJob(const int channel);
+    void pushBandsToAnalyser(const bool compressed);
+    // Steps the bands' solo/mute and bypass fades on by up to fadeStep and
+    // decides which bands need splitting and compressing
+    void updateBands(const float fadeStep);
+    // Clears the band's filters on rows first to end-1, for a band that is
+    // coming back after being skipped
+    void resetBand(const int band, const int firstRow, const int endRow);
+
+    void createFactoryPrograms();
+    // A program holding the current value of every parameter, of which only
+    // the program parameters are used
+    ProgramBank::Program* createProgram(const String& name);
+    // Works out a program's crossover sections and curves
+    void prepareProgram(ProgramBank::Program& program, const double sampleRate) const;
+    // Applies a program picked since the last block, crossfading to it over
+    // the start of the block. Returns the number of samples processed.
+    int applyPendingProgram(AudioSampleBuffer& buffer, const int numSamples, const int numProcessedChannels);
+    void applyProgram(const ProgramBank::Program& program);
+    // Copy of the crossover engine's state, to process samples twice over
+    void saveProcessingState();
+    void restoreProcessingState();
+
+    void splitBand(const int channel, const int band, const float* in, float* out, const int numSamples);
+    void splitBand(const int channel, const int band, const float* inA, const float* inB,
+                   const float gainA, const float gainB, float* out, const int numSamples);
+
+    // Sub-band signals are stored band by band for each channel in turn
+    float* getBandPointer(const int channel, const int band)
+    {
+        return bandBuffer_.getWritePointer(channel * (numXOverPerChannel+1) + band);
+    }
 
     std::vector<std::vector<std::unique_ptr<CrossoverFilter>>> crossoverFilters_;
     std::vector<std::vector<std::unique_ptr<Compressor>>> compressors_;
@@ -127,12 +282,138 @@ private:
     std::vector<AudioParameterFloat*> compressorGain;
     std::vector<AudioParameterFloat*> compressorAttack;
     std::vector<AudioParameterFloat*> compressorRelease;
-
-
+    std::vector<AudioParameterFloat*> compressorKnee;
+    AudioParameterBool* controlRateActive;
+    AudioParameterFloat* controlRateInterval;
+    AudioParameterBool* linearPhaseActive;
+    AudioParameterBool* spectralActive;
+    AudioParameterFloat* spectralBands;
+    AudioParameterBool* sampleAccurateActive;
+    AudioParameterBool* sidechainActive;
+    AudioParameterBool* midSideActive;
+    AudioParameterChoice* channelLink;
+    AudioParameterBool* sharedThreadsActive;
+    AudioParameterBool* loudnessActive;
+    std::vector<AudioParameterBool*> sideActive;
+    std::vector<AudioParameterFloat*> sideThresh;
+    std::vector<AudioParameterFloat*> sideRatio;
+    std::vector<AudioParameterFloat*> sideGain;
+    std::vector<AudioParameterFloat*> sideAttack;
+    std::vector<AudioParameterFloat*> sideRelease;
+    std::vector<AudioParameterFloat*> sideKnee;
+    std::vector<AudioParameterBool*> bandSolo;
+    std::vector<AudioParameterBool*> bandMute;
+    std::vector<AudioParameterBool*> bandBypass;
+    AudioParameterBool* autoReleaseActive;
+
+
+    // Rows of crossover filters: the main channels, then the sidechain's
     int numCrossoverFilters_;
+    int numKeyChannels_ = 0;
+    // Whether the sidechain's rows are being split, for this segment
+    bool keyed_ = false;
     int numCompressors_;
     bool linkwitzRiley_ = true;
 
+    AudioSampleBuffer bandBuffer_;
+    // Working buffer for the compressors, one row per channel
+    AudioSampleBuffer compressorScratch_;
+    // Static curves shared by the compressors of each band (see the
+    // constructor)
+    std::vector<GainCurve> curves_;
+    std::vector<const float*> bandPointers_;
+    std::vector<const float*> linkPointers_;
+    AudioSampleBuffer linkBuffer_;
+
+    // Solo/mute and bypass state of each band, shared by every channel. The
+    // level and mix are ramped linearly between their start and end values
+    // across each segment.
+    struct BandState
+    {
+        float level, levelStart;    // 0 when muted (or another band is soloed)
+        float mix, mixStart;        // 0 when bypassed
+        bool active;                // Split, compressed and summed
+        bool compressed;            // Compressed (and its key split)
+    };
+    std::vector<BandState> bandStates_;
+
+    // The segment being processed, for the stage jobs
+    struct SegmentContext
+    {
+        AudioSampleBuffer* buffer;
+        int startSample, numSamples;
+        int numProcessedChannels, numKeyChannels;
+        int numMainRows, groupSize;
+    };
+    SegmentContext segment_;
+    // The shared pool is only created, on the message thread, once shared
+    // threads are first switched on, so instances that never use them
+    // start no threads. threadPool_ is what the audio thread sees of it.
+    std::unique_ptr<SharedResourcePointer<DSPThreadPool>> threadPoolHolder_;
+    Atomic<DSPThreadPool*> threadPool_;
+    bool useThreadPool_ = false;
+    const DSPKernels* kernels_ = nullptr;
+
+    // FIR alternative to crossoverFilters_, used when linearPhaseActive is
+    // set. The mode only changes between blocks; the filters are designed
+    // off the audio thread.
+    LinearPhaseCrossover linearPhase_;
+    std::vector<float> crossoverFreqValues_;
+    bool linearPhaseEnabled_ = false;
+    // Left by the audio thread for timerCallback
+    Atomic<int> pendingLatency_;
+    Atomic<int> designWanted_;
+
+    // STFT engine used in place of the crossover bank when spectralActive
+    // is set. Its bands take their settings from the crossover band they
+    // fall in.
+    SpectralMultiband spectral_;
+    bool spectralEnabled_ = false;
+
+    // Channels 0 and 1 carry mid and side rather than left and right
+    bool midSideEnabled_ = false;
+
+    // Offline quality mode, on while the host renders offline (see
+    // isNonRealtime): automation is always sample accurate, gains are
+    // always computed at audio rate and the compressors detect true peaks,
+    // with the bands delayed to match. Everything it needs is allocated in
+    // prepareToPlay.
+    bool highQuality_ = false;
+    TruePeakDetector truePeak_;
+    AudioSampleBuffer truePeakBuffer_;     // One row per channel
+
+    // Factory and user programs. A program picked with setCurrentProgram
+    // is applied at the start of the next block, which is processed from
+    // the same state with the old settings and with the new, and crossfaded
+    // over kProgramFadeMs (or the whole block, if that's shorter).
+    ProgramBank programs_;
+    std::vector<int> programParameters_;  // Indices of the parameters a program sets
+    AudioSampleBuffer programFadeBuffer_;  // Input rows, then old output rows
+    std::vector<CrossoverFilter> filterSnapshot_;
+    std::vector<Compressor::Envelope> envelopeSnapshot_;
+    std::vector<BandState> bandSnapshot_;
+    TruePeakDetector truePeakSnapshot_;
+    bool programInstalled_ = false;        // Coefficients the analyser hasn't seen
+    Atomic<int> programApplied_;           // For the host, from the message thread
+    bool fadingOut_ = false;               // Processing with the old program's settings
+
+    LoudnessMeter loudness_;
+    bool loudnessEnabled_ = false;
+    SpectrumAnalyser analyser_;
+
+    // Timestamped parameter changes, and space to sort one block's worth
+    AutomationQueue automation_;
+    HeapBlock<AutomationEvent> automationEvents_;
+    ParameterChangeQueue parameterChanges_;
+    // Applied from automation_ and not yet passed on to the host by
+    // timerCallback
+    ParameterChangeQueue automatedParameters_;
+    HeapBlock<int> automatedIndices_;
+
+    PerformanceMonitor performance_;
+    SharedResourcePointer<TraceWriter> traceWriter_;
+    TraceBuffer trace_;
+
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Assignment1Processor);
 };
@@ -0,0 +1,58 @@
+#include "ProgramBank.h"
+
+void ProgramBank::addProgram(Program* program)
+{
+    programs.emplace_back(program);
+}
+
+ProgramBank::Program* ProgramBank::getProgram(const int index) const noexcept
+{
+    return isPositiveAndBelow(index, getNumPrograms()) ? programs[(size_t) index].get() : nullptr;
+}
+
+void ProgramBank::replaceProgram(const int index, Program* program)
+{
+    std::unique_ptr<Program> replacement(program);
+    if(! isPositiveAndBelow(index, getNumPrograms()))
+        return;
+    std::unique_ptr<Program>& slot = programs[(size_t) index];
+
+    // Once the old program isn't pending, the audio thread can only have it
+    // if it took it before we looked, in which case it's still applying it
+    pending.compareAndSetBool(replacement.get(), slot.get());
+    while(applying.get() != 0)
+        Thread::yield();
+    std::swap(slot, replacement);
+}
+
+void ProgramBank::select(const int index)
+{
+    if(Program* program = getProgram(index)) {
+        currentProgram = index;
+        pending.set(program);
+    }
+}
+
+void ProgramBank::setCurrentWithoutApplying(const int index)
+{
+    if(getProgram(index) != nullptr)
+        currentProgram = index;
+}
+
+const ProgramBank::Program* ProgramBank::beginApply() noexcept
+{
+    // Marked before taking the program, so replaceProgram() can't miss it
+    applying.set(1);
+    return pending.exchange(nullptr);
+}
+
+size_t ProgramBank::getMemoryUsage() const noexcept
+{
+    size_t bytes = sizeof(std::unique_ptr<Program>) * programs.capacity();
+    for(const auto& program : programs) {
+        bytes += sizeof(Program) + sizeof(float) * program->values.capacity()
+               + sizeof(CrossoverFilter) * program->filters.capacity()
+               + sizeof(GainCurve) * program->curves.capacity();
+    }
+    return bytes;
+}
@@ -0,0 +1,80 @@
+#ifndef __PROGRAMBANK_H__
+#define __PROGRAMBANK_H__
+
+#include "JuceHeader.h"
+#include "CrossoverFilter.h"
+#include "GainCurve.h"
+#include <vector>
+#include <memory>
+
+//==============================================================================
+/**
+ * The factory and user programs, and the hand-over of the selected one to
+ * the audio thread.
+ *
+ * Each program holds the normalised value of every parameter, plus the
+ * crossover sections and static gain curves those values make at the
+ * current sample rate, worked out ahead of time on the message thread. The
+ * processor fills those in (see Assignment1Processor::prepareProgram), so
+ * selecting a program costs the audio thread copies rather than filter and
+ * curve design.
+ *
+ * A program is never changed while the audio thread may be reading it:
+ * storing into a slot replaces the whole program, once the audio thread has
+ * finished with the old one. Selecting a program publishes a pointer to it,
+ * which the audio thread takes, wait-free, at the start of its next block.
+ */
+class ProgramBank
+{
+public:
+    struct Program
+    {
+        String name;
+        // Normalised, one per parameter. The processor only applies and
+        // saves those of its program parameters.
+        std::vector<float> values;
+
+        // Made from values for sampleRate (0 until they've been made): the
+        // crossover filters of one channel, in the order the processor keeps
+        // them, and the curve of each band, main then side
+        double sampleRate = 0;
+        std::vector<CrossoverFilter> filters;
+        std::vector<GainCurve> curves;
+    };
+
+    ProgramBank() {}
+    ~ProgramBank() {}
+
+    // Message thread
+    void addProgram (Program* program);
+    int getNumPrograms() const noexcept { return (int) programs.size(); }
+    Program* getProgram (const int index) const noexcept;
+    // Swaps in a new program for the one in a slot, waiting for the audio
+    // thread if it's applying the old one. Selects the new one if the old
+    // one was waiting to be applied.
+    void replaceProgram (const int index, Program* program);
+    void select (const int index);
+    // Makes a program current without handing it to the audio thread, for
+    // restored state that sets the parameters itself
+    void setCurrentWithoutApplying (const int index);
+    int getCurrentProgram() const noexcept { return currentProgram; }
+
+    // Audio thread: the program selected since the last call, or null. The
+    // program stays valid until endApply().
+    const Program* beginApply() noexcept;
+    void endApply() noexcept { applying.set(0); }
+
+    // Bytes held by the programs and their tables
+    size_t getMemoryUsage() const noexcept;
+
+private:
+    std::vector<std::unique_ptr<Program>> programs;
+    int currentProgram = 0;
+
+    Atomic<Program*> pending;
+    Atomic<int> applying;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ProgramBank);
+};
+
+#endif
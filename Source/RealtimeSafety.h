@@ -0,0 +1,84 @@
+#ifndef __REALTIMESAFETY_H__
+#define __REALTIMESAFETY_H__
+
+#include "JuceHeader.h"
+
+// Set to 1 in the test executable (Tests/Assignment1Tests.jucer) to catch
+// the audio thread allocating or locking. This replaces the process's
+// memory allocation and lock functions, so leave it at 0 in the plugin.
+#ifndef ASSIGNMENT1_RT_CHECKS
+ #define ASSIGNMENT1_RT_CHECKS 0
+#endif
+
+//==============================================================================
+/**
+ * Counts the things real-time code mustn't do: allocate or free memory,
+ * take a lock or wait on a condition or semaphore.
+ *
+ * Threads mark the stretches where they do real-time work with
+ * ASSIGNMENT1_REALTIME_SCOPE. With ASSIGNMENT1_RT_CHECKS set, the allocation
+ * functions (malloc and friends with glibc, operator new and delete
+ * elsewhere) and, with glibc, the pthread mutex, read-write lock and
+ * condition functions and sem_wait are replaced by versions that count
+ * each call made from inside such a stretch before passing it on. The
+ * replacements live in Tests/RealtimeSafety.cpp, which only the test
+ * executable compiles. Without it nothing is counted and the scopes
+ * compile to nothing.
+ *
+ * The counts are for the whole process and can be read from any thread.
+ */
+class RealtimeSafety
+{
+public:
+    enum Violation
+    {
+        kAllocation = 0,    // Includes reallocation
+        kDeallocation,
+        kLock,              // Includes try-locks
+        kWait,
+        kNumViolations
+    };
+
+    // Marks the calling thread as doing real-time work until the end of the
+    // scope. Scopes can be nested.
+    struct ScopedRealtime
+    {
+        ScopedRealtime() noexcept   { ++getDepth(); }
+        ~ScopedRealtime() noexcept  { --getDepth(); }
+    };
+
+    static bool isRealtime() noexcept { return getDepth() > 0; }
+
+    // Called by the replacement functions. Counts the call if the calling
+    // thread is doing real-time work.
+    static void check (const Violation violation) noexcept
+    {
+        if (isRealtime())
+            ++counts[violation];
+    }
+
+    static int64 getCount (const Violation violation) noexcept { return counts[violation].get(); }
+    static void resetCounts() noexcept;
+    static const char* getName (const Violation violation) noexcept;
+
+    // Whether the replacement functions are compiled in
+    static bool isChecking() noexcept { return ASSIGNMENT1_RT_CHECKS != 0; }
+
+private:
+    static int& getDepth() noexcept
+    {
+        static thread_local int depth = 0;
+        return depth;
+    }
+
+    static Atomic<int64> counts[kNumViolations];
+};
+
+#if ASSIGNMENT1_RT_CHECKS
+ #define ASSIGNMENT1_REALTIME_SCOPE() \
+    RealtimeSafety::ScopedRealtime JUCE_JOIN_MACRO (realtimeScope_, __LINE__)
+#else
+ #define ASSIGNMENT1_REALTIME_SCOPE()
+#endif
+
+#endif
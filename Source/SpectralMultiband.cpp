@@ -0,0 +1,174 @@
+#include "SpectralMultiband.h"
+#include <cmath>
+#include <cstring>
+
+void SpectralMultiband::prepare(const double sampleRate, const int numChannels)
+{
+    this->sampleRate = sampleRate;
+
+    // Frames of about 20ms (1024 samples at 44.1 and 48kHz), which resolves
+    // bands down to a bin of about 45Hz
+    int order = 0;
+    while((1 << order) < (int) (sampleRate * 0.02))
+        ++order;
+    fftSize = 1 << order;
+    hopSize = fftSize / 4;
+    forward.reset(new FFT(order, false));
+    inverse.reset(new FFT(order, true));
+
+    // Square root Hann windows on both sides. At 75% overlap the products
+    // sum to 2, which is folded into the synthesis window along with the
+    // 1/fftSize the inverse transform leaves out.
+    analysisWindow.allocate(fftSize, false);
+    synthesisWindow.allocate(fftSize, false);
+    for(int n = 0; n < fftSize; ++n) {
+        const float w = (float) sqrt(0.5 - 0.5 * cos(2.0 * double_Pi * n / fftSize));
+        analysisWindow[n] = w;
+        synthesisWindow[n] = w / (2.0f * fftSize);
+    }
+    // Sum of the bin energies of a windowed sine of amplitude A is
+    // A^2 * fftSize * (sum of w^2) / 4, and the sum of w^2 is fftSize / 2.
+    // Levels are measured as the peak of the equivalent sine so that
+    // thresholds behave like the time domain compressors' peak detector.
+    energyScale = 8.0f / ((float) fftSize * fftSize);
+
+    channels.resize(numChannels);
+    for(auto& state : channels) {
+        state.input.allocate(fftSize, true);
+        state.output.allocate(fftSize, true);
+        state.fill = 0;
+        state.time.allocate(fftSize, true);
+        state.freq.allocate(fftSize, true);
+        state.binGain.allocate(fftSize / 2 + 1, true);
+    }
+    curves.resize(kMaxBands);
+    compressors.resize(numChannels * kMaxBands);
+    for(size_t i = 0; i < compressors.size(); ++i)
+        compressors[i] = std::make_unique<Compressor>(&curves[i % kMaxBands]);
+
+    // Regroup the bins for the new frame size
+    const int bands = (numBands > 0) ? numBands : (int) kMinBands;
+    numBands = 0;
+    setNumBands(bands);
+}
+
+void SpectralMultiband::reset() noexcept
+{
+    for(auto& state : channels) {
+        FloatVectorOperations::clear(state.input, fftSize);
+        FloatVectorOperations::clear(state.output, fftSize);
+        state.fill = 0;
+    }
+}
+
+bool SpectralMultiband::setNumBands(int newNumBands) noexcept
+{
+    newNumBands = jlimit((int) kMinBands, (int) kMaxBands, newNumBands);
+    if(newNumBands == numBands || fftSize == 0)
+        return false;
+    numBands = newNumBands;
+
+    // Band edges are spaced logarithmically from the first bin up to
+    // Nyquist, with DC in the lowest band. Every band gets at least one bin,
+    // so the lowest bands are a bin wide when there are many of them.
+    const int numBins = fftSize / 2 + 1;
+    bandStart[0] = 0;
+    for(int b = 1; b < numBands; ++b) {
+        const int edge = (int) (pow((double) numBins, (double) b / numBands) + 0.5);
+        bandStart[b] = jlimit(bandStart[b-1] + 1, numBins - (numBands - b), edge);
+    }
+    bandStart[numBands] = numBins;
+    for(int b = 0; b < numBands; ++b)
+        bandCentre[b] = 0.5f * (bandStart[b] + bandStart[b+1] - 1);
+    return true;
+}
+
+float SpectralMultiband::getBandFrequency(const int band) const noexcept
+{
+    return (float) (bandCentre[band] * sampleRate / fftSize);
+}
+
+void SpectralMultiband::process(const int channel, float* samples, const int numSamples) noexcept
+{
+    ChannelState& state = channels[channel];
+    int done = 0;
+    while(done < numSamples) {
+        // Take input before writing output so samples can be processed in
+        // place
+        const int chunk = jmin(numSamples - done, hopSize - state.fill);
+        FloatVectorOperations::copy(state.input + fftSize - hopSize + state.fill, samples + done, chunk);
+        FloatVectorOperations::copy(samples + done, state.output + state.fill, chunk);
+        state.fill += chunk;
+        if(state.fill == hopSize) {
+            processFrame(channel);
+            state.fill = 0;
+        }
+        done += chunk;
+    }
+}
+
+void SpectralMultiband::processFrame(const int channel) noexcept
+{
+    ChannelState& state = channels[channel];
+    const int half = fftSize / 2;
+    FFT::Complex* time = state.time;
+    FFT::Complex* freq = state.freq;
+    float* binGain = state.binGain;
+    float* bandGain = state.bandGain;
+
+    for(int j = 0; j < fftSize; ++j) {
+        time[j].r = state.input[j] * analysisWindow[j];
+        time[j].i = 0.0f;
+    }
+    forward->perform(time, freq);
+
+    // One level and one gain computation per band
+    for(int b = 0; b < numBands; ++b) {
+        float energy = 0;
+        for(int k = bandStart[b]; k < bandStart[b+1]; ++k)
+            energy += freq[k].r * freq[k].r + freq[k].i * freq[k].i;
+        // Floored at -120dB, like the time domain detector
+        const float level = 10.0f * log10(jmax(energy * energyScale, 1.0e-12f));
+        bandGain[b] = getCompressor(channel, b).processLevel(level, hopSize);
+    }
+
+    // Interpolate the gain between band centres rather than stepping it at
+    // band edges, which would smear into neighbouring bins as ringing
+    int b = 0;
+    for(int k = 0; k <= half; ++k) {
+        while(b < numBands - 1 && k >= bandCentre[b+1])
+            ++b;
+        if(k <= bandCentre[0] || b == numBands - 1) {
+            binGain[k] = bandGain[b];
+        } else {
+            const float t = (k - bandCentre[b]) / (bandCentre[b+1] - bandCentre[b]);
+            binGain[k] = bandGain[b] + t * (bandGain[b+1] - bandGain[b]);
+        }
+    }
+    // Apply to both halves of the spectrum so the output stays real
+    for(int k = 0; k <= half; ++k) {
+        freq[k].r *= binGain[k];
+        freq[k].i *= binGain[k];
+    }
+    for(int k = 1; k < half; ++k) {
+        freq[fftSize - k].r *= binGain[k];
+        freq[fftSize - k].i *= binGain[k];
+    }
+    inverse->perform(freq, time);
+
+    // Overlap-add into the accumulator, which moves along by one hop, and
+    // move the input along to make room for the next hop
+    memmove(state.output, state.output + hopSize, sizeof(float) * (size_t) (fftSize - hopSize));
+    FloatVectorOperations::clear(state.output + fftSize - hopSize, hopSize);
+    for(int j = 0; j < fftSize; ++j)
+        state.output[j] += time[j].r * synthesisWindow[j];
+    memmove(state.input, state.input + hopSize, sizeof(float) * (size_t) (fftSize - hopSize));
+}
+
+size_t SpectralMultiband::getMemoryUsage() const noexcept
+{
+    return sizeof(float) * (size_t) (fftSize * 2 + channels.size() * (fftSize * 2 + fftSize / 2 + 1))
+         + sizeof(FFT::Complex) * (size_t) (channels.size() * fftSize * 2)
+         + sizeof(GainCurve) * curves.size()
+         + sizeof(Compressor) * compressors.size();
+}
@@ -0,0 +1,97 @@
+#ifndef __SPECTRALMULTIBAND_H__
+#define __SPECTRALMULTIBAND_H__
+
+#include "JuceHeader.h"
+#include "Compressor.h"
+#include <vector>
+#include <memory>
+
+//==============================================================================
+/**
+ * Frequency domain multiband compressor for high band counts.
+ *
+ * Each channel is analysed with a short-time Fourier transform (square root
+ * Hann windows, 75% overlap). The bins of each frame are grouped into
+ * logarithmically spaced bands, the energy of every band is passed to its
+ * own Compressor as a level, and the resulting gains are interpolated
+ * across the bins between band centres before the frame is resynthesised by
+ * overlap-add.
+ *
+ * The cost is one forward and one inverse FFT per hop per channel whatever
+ * the number of bands, so 32 bands cost little more than 4. The trade-off
+ * is a fixed latency of one FFT frame and gain changes limited to once per
+ * hop. All memory is allocated in prepare().
+ */
+class SpectralMultiband
+{
+public:
+    SpectralMultiband() {}
+    ~SpectralMultiband() {}
+
+    enum
+    {
+        kMinBands = 16,
+        kMaxBands = 32
+    };
+
+    void prepare (const double sampleRate, const int numChannels);
+    void reset() noexcept;
+
+    // Regroups the bins into numBands bands (clamped to kMinBands-kMaxBands).
+    // Returns true if the number of bands changed. Doesn't allocate.
+    bool setNumBands (int numBands) noexcept;
+    int getNumBands() const noexcept { return numBands; }
+    // Centre frequency of a band in Hz, for mapping settings onto bands
+    float getBandFrequency (const int band) const noexcept;
+
+    // Compressor for one band of one channel. Set up like any other
+    // Compressor; only its gain curve and ballistics are used.
+    Compressor& getCompressor (const int channel, const int band) noexcept
+    {
+        return *compressors[channel * kMaxBands + band];
+    }
+
+    // Processes one channel in place. Any number of samples per call.
+    // Different channels can be processed at the same time on different
+    // threads.
+    void process (const int channel, float* samples, const int numSamples) noexcept;
+
+    // Delay added by the engine, in samples
+    int getLatency() const noexcept { return fftSize; }
+
+    // Bytes allocated by prepare()
+    size_t getMemoryUsage() const noexcept;
+
+private:
+    struct ChannelState
+    {
+        HeapBlock<float> input;     // Last fftSize samples of input
+        HeapBlock<float> output;    // Overlap-add accumulator
+        int fill = 0;               // Samples of the current hop received
+        // Working buffers, kept per channel so channels are independent
+        HeapBlock<FFT::Complex> time, freq;
+        HeapBlock<float> binGain;
+        float bandGain[kMaxBands];
+    };
+
+    void processFrame (const int channel) noexcept;
+
+    std::unique_ptr<FFT> forward, inverse;
+    std::vector<ChannelState> channels;
+    // Static curves, one per band, shared by that band's compressor on
+    // every channel
+    std::vector<GainCurve> curves;
+    std::vector<std::unique_ptr<Compressor>> compressors;  // kMaxBands per channel
+    HeapBlock<float> analysisWindow, synthesisWindow;
+    int bandStart[kMaxBands + 1];           // First bin of each band, plus the end
+    float bandCentre[kMaxBands];            // Centre of each band in bins
+    double sampleRate = 44100.0;
+    int fftSize = 0, hopSize = 0;
+    int numBands = 0;
+    // Converts band energy to the level of a sine with the same energy
+    float energyScale = 1.0f;
+
+    JUCE_LEAK_DETECTOR (SpectralMultiband);
+};
+
+#endif
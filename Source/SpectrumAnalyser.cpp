@@ -0,0 +1,266 @@
+#include "SpectrumAnalyser.h"
+#include <complex>
+
+//==============================================================================
+class SpectrumAnalyser::Worker : public Thread
+{
+public:
+    Worker(SpectrumAnalyser& a)
+        : Thread("Spectrum analyser"), analyser(a)
+    {
+    }
+
+    void run() override
+    {
+        while(! threadShouldExit()) {
+            analyser.analyse();
+            wait(kIntervalMs);
+        }
+    }
+
+private:
+    SpectrumAnalyser& analyser;
+};
+
+//==============================================================================
+SpectrumAnalyser::SpectrumAnalyser()
+    : fft(kFFTOrder, false)
+{
+    time.allocate(kFFTSize, true);
+    freq.allocate(kFFTSize, true);
+    window.allocate(kFFTSize, true);
+    for(int i = 0; i < kFFTSize; ++i)
+        window[i] = 0.5f - 0.5f * std::cos(2.0f * float_Pi * i / kFFTSize);
+    pointBins.allocate(kNumPoints + 1, true);
+    points.allocate(kNumPoints, true);
+    for(int i = 0; i < kMaxFilters; ++i) {
+        stages[i] = 0;
+        for(int c = 0; c < 5; ++c)
+            coefficients[i][c] = 0;
+    }
+    worker.reset(new Worker(*this));
+}
+
+SpectrumAnalyser::~SpectrumAnalyser()
+{
+    worker->stopThread(1000);
+}
+
+void SpectrumAnalyser::prepare(const double newSampleRate, const int newNumBands)
+{
+    // The worker reads everything allocated here
+    const bool wasActive = isActive();
+    if(wasActive)
+        worker->stopThread(1000);
+
+    // The editor can be reading at any time
+    const ScopedLock sl(readingLock);
+    sampleRate = newSampleRate;
+    numBands = jlimit(1, (int) kMaxBands, newNumBands);
+    channels.reset(new Channel[(size_t) numBands * 2]);
+    for(int i = 0; i < numBands * 2; ++i) {
+        channels[i].fifo.reset(new AbstractFifo(kFifoSize));
+        channels[i].samples.allocate(kFifoSize, true);
+        channels[i].frame.allocate(kFFTSize, true);
+        channels[i].levels.allocate(kNumPoints, false);
+        for(int p = 0; p < kNumPoints; ++p)
+            channels[i].levels[p] = (float) kFloor;
+    }
+    response.allocate((size_t) numBands * kNumPoints, true);
+
+    // Each point covers the bins between it and halfway to its neighbours.
+    // At the bottom, where points are closer together than bins, they take
+    // the nearest bin instead.
+    for(int p = 0; p <= kNumPoints; ++p) {
+        const double edge = getPointFrequency(p) * std::pow(getPointFrequency(kNumPoints - 1) / kMinFrequency,
+                                                            -0.5 / (kNumPoints - 1));
+        pointBins[p] = jlimit(0, kFFTSize / 2, roundToInt(edge * kFFTSize / sampleRate));
+    }
+    for(int p = 0; p < kNumPoints; ++p)
+        points[p] = getPointFrequency(p);
+
+    lastSequence = -1;
+    crossoverWanted.set(1);
+    version.set(0);
+    if(wasActive)
+        worker->startThread(3);
+}
+
+void SpectrumAnalyser::setActive(const bool shouldBeActive)
+{
+    if(shouldBeActive == isActive())
+        return;
+    if(shouldBeActive) {
+        crossoverWanted.set(1);
+        active.set(1);
+        worker->startThread(3);
+    }
+    else {
+        active.set(0);
+        worker->stopThread(1000);
+    }
+}
+
+float SpectrumAnalyser::getPointFrequency(const int point) const noexcept
+{
+    const double top = sampleRate * 0.5;
+    return (float) (kMinFrequency * std::pow(top / kMinFrequency, point / (double) (kNumPoints - 1)));
+}
+
+//==============================================================================
+void SpectrumAnalyser::pushBand(const int band, const bool compressed, const float* samples, const int numSamples) noexcept
+{
+    if(! isPositiveAndBelow(band, numBands))
+        return;
+    Channel& channel = getChannel(band, compressed);
+    int start1, size1, start2, size2;
+    channel.fifo->prepareToWrite(numSamples, start1, size1, start2, size2);
+    memcpy(channel.samples + start1, samples, sizeof(float) * (size_t) size1);
+    memcpy(channel.samples + start2, samples + size1, sizeof(float) * (size_t) size2);
+    channel.fifo->finishedWrite(size1 + size2);
+}
+
+void SpectrumAnalyser::setCrossover(const double* const* newCoefficients, const int* numStages, const int newNumFilters) noexcept
+{
+    ++sequence;
+    numFilters = jmin((int) kMaxFilters, newNumFilters);
+    for(int i = 0; i < numFilters; ++i) {
+        stages[i] = numStages[i];
+        for(int c = 0; c < 5; ++c)
+            coefficients[i][c] = newCoefficients[i][c];
+    }
+    ++sequence;
+    crossoverWanted.set(0);
+}
+
+//==============================================================================
+void SpectrumAnalyser::analyse()
+{
+    bool updated = false;
+    for(int i = 0; i < numBands * 2; ++i) {
+        Channel& channel = channels[i];
+        const bool hasData = readChannel(channel);
+
+        // Bands that have stopped receiving samples (e.g. while the spectral
+        // engine is in use) fall away to the floor
+        if(hasData) {
+            for(int n = 0; n < kFFTSize; ++n) {
+                time[n].r = channel.frame[n] * window[n];
+                time[n].i = 0;
+            }
+            fft.perform(time, freq);
+        }
+        // Full scale sine = 0dB: the window halves the amplitude and a real
+        // signal's energy is split between positive and negative bins
+        const float scale = 4.0f / kFFTSize;
+        const ScopedLock sl(readingLock);
+        for(int p = 0; p < kNumPoints; ++p) {
+            float level = (float) kFloor;
+            if(hasData) {
+                float magnitude = 0;
+                const int first = pointBins[p], last = jmax(first + 1, pointBins[p + 1]);
+                for(int bin = first; bin < jmin(last, (int) kFFTSize / 2 + 1); ++bin)
+                    magnitude = jmax(magnitude, std::sqrt(freq[bin].r * freq[bin].r + freq[bin].i * freq[bin].i));
+                level = Decibels::gainToDecibels(magnitude * scale, (float) kFloor);
+            }
+            const float held = jmax(level, channel.levels[p] - (float) kFallPerUpdate);
+            updated |= held != channel.levels[p];
+            channel.levels[p] = held;
+        }
+    }
+    updateCrossoverResponse();
+    if(updated)
+        ++version;
+}
+
+// Slides everything that has arrived since the last update into the frame.
+// Returns false if nothing had.
+bool SpectrumAnalyser::readChannel(Channel& channel) noexcept
+{
+    AbstractFifo& fifo = *channel.fifo;
+    const int numReady = fifo.getNumReady();
+    if(numReady == 0)
+        return false;
+    // Only the newest kFFTSize samples matter
+    const int numSkipped = jmax(0, numReady - kFFTSize);
+    fifo.finishedRead(numSkipped);
+    const int numNew = numReady - numSkipped;
+    memmove(channel.frame, channel.frame + numNew, sizeof(float) * (size_t) (kFFTSize - numNew));
+    int start1, size1, start2, size2;
+    fifo.prepareToRead(numNew, start1, size1, start2, size2);
+    float* dest = channel.frame + kFFTSize - numNew;
+    memcpy(dest, channel.samples + start1, sizeof(float) * (size_t) size1);
+    memcpy(dest + size1, channel.samples + start2, sizeof(float) * (size_t) size2);
+    fifo.finishedRead(size1 + size2);
+    return true;
+}
+
+// Evaluates each band's magnitude response at the display points, once per
+// new set of coefficients
+void SpectrumAnalyser::updateCrossoverResponse()
+{
+    const int start = sequence.get();
+    if(start == lastSequence || (start & 1) != 0)
+        return;
+    double c[kMaxFilters][5];
+    int s[kMaxFilters];
+    const int n = numFilters;
+    for(int i = 0; i < n; ++i) {
+        s[i] = stages[i];
+        for(int k = 0; k < 5; ++k)
+            c[i][k] = coefficients[i][k];
+    }
+    // Written to while we were reading; try again next time
+    if(sequence.get() != start)
+        return;
+    lastSequence = start;
+
+    // |H(f)| of each filter at each point, raised to its number of stages
+    typedef std::complex<double> Complex;
+    HeapBlock<double> magnitudes((size_t) jmax(1, n) * kNumPoints);
+    for(int i = 0; i < n; ++i) {
+        for(int p = 0; p < kNumPoints; ++p) {
+            const double w = 2.0 * double_Pi * points[p] / sampleRate;
+            const Complex z1 = std::polar(1.0, -w), z2 = z1 * z1;
+            const Complex h = (c[i][0] + c[i][1] * z1 + c[i][2] * z2) / (1.0 + c[i][3] * z1 + c[i][4] * z2);
+            magnitudes[i * kNumPoints + p] = std::pow(std::abs(h), s[i]);
+        }
+    }
+
+    const ScopedLock sl(readingLock);
+    for(int band = 0; band < numBands; ++band) {
+        const int first = (band == 0) ? 0 : band * 2 - 1;
+        const int last = (band == numBands - 1) ? band * 2 - 1 : band * 2;
+        for(int p = 0; p < kNumPoints; ++p) {
+            double magnitude = 1.0;
+            for(int i = first; i <= last && i < n; ++i)
+                magnitude *= magnitudes[i * kNumPoints + p];
+            response[band * kNumPoints + p] = Decibels::gainToDecibels((float) magnitude, (float) kFloor);
+        }
+    }
+    ++version;
+}
+
+//==============================================================================
+void SpectrumAnalyser::getSpectrum(const int band, const bool compressed, float* dest) const
+{
+    const ScopedLock sl(readingLock);
+    for(int p = 0; p < kNumPoints; ++p)
+        dest[p] = isPositiveAndBelow(band, numBands) ? getChannel(band, compressed).levels[p] : (float) kFloor;
+}
+
+void SpectrumAnalyser::getCrossoverResponse(const int band, float* dest) const
+{
+    const ScopedLock sl(readingLock);
+    for(int p = 0; p < kNumPoints; ++p)
+        dest[p] = isPositiveAndBelow(band, numBands) ? response[band * kNumPoints + p] : (float) kFloor;
+}
+
+size_t SpectrumAnalyser::getMemoryUsage() const noexcept
+{
+    const size_t perChannel = sizeof(Channel) + sizeof(AbstractFifo)
+                            + sizeof(float) * (kFifoSize + kFFTSize + kNumPoints);
+    return perChannel * (size_t) numBands * 2 + sizeof(float) * (size_t) numBands * kNumPoints
+         + sizeof(FFT::Complex) * kFFTSize * 2 + sizeof(float) * (kFFTSize + kNumPoints)
+         + sizeof(int) * (kNumPoints + 1);
+}
@@ -0,0 +1,129 @@
+#ifndef __SPECTRUMANALYSER_H__
+#define __SPECTRUMANALYSER_H__
+
+#include "JuceHeader.h"
+#include <memory>
+
+//==============================================================================
+/**
+ * Spectra of each band before and after compression, and the magnitude
+ * response of the crossover that made the bands, for display.
+ *
+ * The audio thread copies band signals into one single producer, single
+ * consumer FIFO per band and stage, which is all it does. A background
+ * thread drains the FIFOs about 30 times a second and works out a Hann
+ * windowed FFT of the latest frame of each, reduced to kNumPoints
+ * log-spaced points in dB with a falling peak hold.
+ *
+ * The crossover response only changes with the filter coefficients, so the
+ * audio thread hands them over (wait-free, through a sequence counter) only
+ * when they are recalculated, and the background thread evaluates the
+ * response once for each new set.
+ *
+ * Call prepare() and setActive() from the message thread. Nothing is pushed
+ * or analysed while the analyser is inactive, i.e. while no editor shows it.
+ */
+class SpectrumAnalyser
+{
+public:
+    SpectrumAnalyser();
+    ~SpectrumAnalyser();
+
+    enum
+    {
+        kMaxBands = 16,
+        kMaxFilters = (kMaxBands - 1) * 2,
+        kFFTOrder = 11,
+        kFFTSize = 1 << kFFTOrder,
+        kNumPoints = 256,       // Log-spaced from kMinFrequency to Nyquist
+        kMinFrequency = 20,
+        kFloor = -100           // dB
+    };
+
+    // Allocates the FIFOs for numBands bands. The audio thread mustn't be
+    // pushing; the editor may be reading.
+    void prepare (const double sampleRate, const int numBands);
+    // Starts or stops the background thread
+    void setActive (const bool shouldBeActive);
+    bool isActive() const noexcept { return active.get() != 0; }
+
+    // Audio thread: copies the samples of one band, before compression or
+    // after. Samples that don't fit are dropped.
+    void pushBand (const int band, const bool compressed, const float* samples, const int numSamples) noexcept;
+
+    // Audio thread: the crossover filters that make the bands, in the order
+    // the processor keeps them: band 0 is filter 0 (low pass), each middle
+    // band b filters 2b-1 (high pass) then 2b (low pass), and the top band
+    // the last filter (high pass). Each filter is numStages[i] identical
+    // biquads with normalised coefficients (b0, b1, b2, a1, a2).
+    void setCrossover (const double* const* coefficients, const int* numStages, const int numFilters) noexcept;
+    // True until the first crossover arrives after activation
+    bool needsCrossover() const noexcept { return crossoverWanted.get() != 0; }
+
+    // Readings for the editor, kNumPoints values in dB each. Counts up
+    // whenever new ones are ready.
+    int getVersion() const noexcept { return version.get(); }
+    void getSpectrum (const int band, const bool compressed, float* dest) const;
+    void getCrossoverResponse (const int band, float* dest) const;
+    // Frequency in Hz of a display point
+    float getPointFrequency (const int point) const noexcept;
+
+    int getNumBands() const noexcept { return numBands; }
+
+    // Bytes allocated by prepare()
+    size_t getMemoryUsage() const noexcept;
+
+private:
+    class Worker;
+    friend class Worker;
+
+    enum
+    {
+        kFifoSize = kFFTSize * 2,
+        kIntervalMs = 30,
+        kFallPerUpdate = 2      // dB the peak hold drops per update
+    };
+
+    struct Channel
+    {
+        std::unique_ptr<AbstractFifo> fifo;
+        HeapBlock<float> samples;       // FIFO storage
+        HeapBlock<float> frame;         // Latest kFFTSize samples, oldest first
+        HeapBlock<float> levels;        // kNumPoints
+    };
+
+    Channel& getChannel (const int band, const bool compressed) noexcept { return channels[band * 2 + (compressed ? 1 : 0)]; }
+    const Channel& getChannel (const int band, const bool compressed) const noexcept { return channels[band * 2 + (compressed ? 1 : 0)]; }
+
+    // Background thread work
+    void analyse();
+    bool readChannel (Channel& channel) noexcept;
+    void updateCrossoverResponse();
+
+    std::unique_ptr<Channel[]> channels;    // Two per band; they own memory, so not a HeapBlock
+    int numBands = 0;
+    double sampleRate = 44100.0;
+
+    FFT fft;
+    HeapBlock<FFT::Complex> time, freq;
+    HeapBlock<float> window;
+    HeapBlock<int> pointBins;       // First bin of each point, and one past the last
+    HeapBlock<float> points;
+
+    // Crossover coefficients from the audio thread. sequence is odd while
+    // they're being written.
+    Atomic<int> sequence, crossoverWanted;
+    double coefficients[kMaxFilters][5];
+    int stages[kMaxFilters];
+    int numFilters = 0;
+    int lastSequence = -1;
+    HeapBlock<float> response;      // kNumPoints per band
+
+    CriticalSection readingLock;    // Between the background thread and the editor
+    Atomic<int> active, version;
+    std::unique_ptr<Worker> worker;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SpectrumAnalyser);
+};
+
+#endif
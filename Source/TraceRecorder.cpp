@@ -0,0 +1,148 @@
+#include "TraceRecorder.h"
+
+namespace
+{
+    // Gives each TraceBuffer a distinct track in the trace
+    Atomic<int> nextInstanceId;
+
+    // How often the writer thread drains the instance buffers, and how many
+    // events it takes from each at a time
+    const int kDrainIntervalMs = 20;
+    const int kScratchSize = 4096;
+}
+
+TraceBuffer::TraceBuffer(const int capacity)
+    : fifo(capacity), instanceId(++nextInstanceId)
+{
+    events.allocate(capacity, true);
+}
+
+int TraceBuffer::pop(TraceEvent* dest, const int maxEvents) noexcept
+{
+    int start1, size1, start2, size2;
+    fifo.prepareToRead(maxEvents, start1, size1, start2, size2);
+    for(int i = 0; i < size1; ++i)
+        dest[i] = events[start1 + i];
+    for(int i = 0; i < size2; ++i)
+        dest[size1 + i] = events[start2 + i];
+    fifo.finishedRead(size1 + size2);
+    return size1 + size2;
+}
+
+//==============================================================================
+TraceWriter::TraceWriter()
+    : Thread("Trace writer"), firstEvent(true)
+{
+    scratch.allocate(kScratchSize, false);
+}
+
+TraceWriter::~TraceWriter()
+{
+    stopWriting();
+}
+
+void TraceWriter::addBuffer(TraceBuffer* buffer)
+{
+    const ScopedLock sl(lock);
+    buffers.add(buffer);
+    if(output != nullptr) {
+        writeInstanceName(buffer);
+        buffer->setEnabled(true);
+    }
+}
+
+void TraceWriter::removeBuffer(TraceBuffer* buffer)
+{
+    // Holding the lock guarantees the writer thread isn't part way through
+    // draining the buffer that is about to be destroyed
+    const ScopedLock sl(lock);
+    buffer->setEnabled(false);
+    buffers.removeFirstMatchingValue(buffer);
+}
+
+bool TraceWriter::startWriting(const File& file)
+{
+    stopWriting();
+    {
+        const ScopedLock sl(lock);
+        file.deleteFile();
+        output.reset(file.createOutputStream());
+        if(output == nullptr)
+            return false;
+        *output << "{\"traceEvents\":[\n";
+        firstEvent = true;
+        for(int i = 0; i < buffers.size(); ++i) {
+            writeInstanceName(buffers[i]);
+            buffers[i]->setEnabled(true);
+        }
+    }
+    startThread();
+    return true;
+}
+
+void TraceWriter::stopWriting()
+{
+    if(output == nullptr)
+        return;
+    stopThread(1000);
+    const ScopedLock sl(lock);
+    for(int i = 0; i < buffers.size(); ++i)
+        buffers[i]->setEnabled(false);
+    // Pick up anything written between the last drain and disabling
+    drainAll();
+    *output << "\n]}\n";
+    output->flush();
+    output = nullptr;
+}
+
+void TraceWriter::run()
+{
+    while(! threadShouldExit()) {
+        {
+            const ScopedLock sl(lock);
+            drainAll();
+        }
+        wait(kDrainIntervalMs);
+    }
+}
+
+void TraceWriter::drainAll()
+{
+    for(int i = 0; i < buffers.size(); ++i) {
+        TraceBuffer* buffer = buffers[i];
+        int numEvents;
+        while((numEvents = buffer->pop(scratch, kScratchSize)) > 0) {
+            for(int j = 0; j < numEvents; ++j)
+                writeEvent(scratch[j], buffer->getInstanceId());
+        }
+    }
+}
+
+void TraceWriter::writeEvent(const TraceEvent& event, const int instanceId)
+{
+    // Timestamps are in microseconds in the Chrome trace format
+    const double ts = Time::highResolutionTicksToSeconds(event.ticks) * 1.0e6;
+    String line;
+    if(! firstEvent)
+        line << ",\n";
+    firstEvent = false;
+    line << "{\"name\":\"" << event.name << "\",\"ph\":\"" << String::charToString(event.phase)
+         << "\",\"ts\":" << String(ts, 3) << ",\"pid\":1,\"tid\":" << instanceId;
+    if(event.phase == 'i')
+        line << ",\"s\":\"t\"";
+    if(event.arg >= 0)
+        line << ",\"args\":{\"value\":" << event.arg << "}";
+    line << "}";
+    *output << line;
+}
+
+void TraceWriter::writeInstanceName(const TraceBuffer* buffer)
+{
+    String line;
+    if(! firstEvent)
+        line << ",\n";
+    firstEvent = false;
+    line << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->getInstanceId()
+         << ",\"args\":{\"name\":\"" << JucePlugin_Name << " #" << buffer->getInstanceId() << "\"}}";
+    *output << line;
+}
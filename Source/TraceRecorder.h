@@ -0,0 +1,158 @@
+#ifndef __TRACERECORDER_H__
+#define __TRACERECORDER_H__
+
+#include "JuceHeader.h"
+
+// Set to 0 to compile all trace points out of the plugin
+#ifndef ASSIGNMENT1_TRACING
+ #define ASSIGNMENT1_TRACING 1
+#endif
+
+//==============================================================================
+/**
+ * A single trace event. Names must be string literals (or otherwise outlive
+ * the trace), as only the pointer is stored.
+ */
+struct TraceEvent
+{
+    int64 ticks;
+    const char* name;
+    int arg;
+    char phase;     // 'B'egin, 'E'nd or 'i'nstant, as in the Chrome trace format
+};
+
+//==============================================================================
+/**
+ * Preallocated single producer, single consumer ring of trace events owned
+ * by one processor instance.
+ *
+ * The audio thread pushes events without locking or allocating; when the
+ * ring is full new events are dropped and counted rather than blocking. The
+ * TraceWriter thread is the only consumer.
+ */
+class TraceBuffer
+{
+public:
+    TraceBuffer (const int capacity = 16384);
+    ~TraceBuffer() {}
+
+    inline bool isEnabled() const noexcept { return enabled.get() != 0; }
+    void setEnabled (const bool shouldBeEnabled) noexcept { enabled.set (shouldBeEnabled ? 1 : 0); }
+
+    inline void begin (const char* name, const int arg = -1) noexcept     { push (name, arg, 'B'); }
+    inline void end (const char* name, const int arg = -1) noexcept       { push (name, arg, 'E'); }
+    inline void instant (const char* name, const int arg = -1) noexcept   { push (name, arg, 'i'); }
+
+    // Called by the writer thread. Copies up to maxEvents events into dest
+    // and returns how many were copied.
+    int pop (TraceEvent* dest, const int maxEvents) noexcept;
+
+    int getNumDropped() const noexcept { return dropped.get(); }
+    // Identifies this instance in the trace (used as the thread id)
+    int getInstanceId() const noexcept { return instanceId; }
+    // Bytes allocated for the ring buffer
+    size_t getMemoryUsage() const noexcept { return sizeof (TraceEvent) * (size_t) fifo.getTotalSize(); }
+
+    // Records a begin event on construction and the matching end event when
+    // it goes out of scope
+    class ScopedEvent
+    {
+    public:
+        ScopedEvent (TraceBuffer& b, const char* n, const int a = -1) noexcept
+            : buffer (b), name (n), arg (a)
+        {
+            buffer.begin (name, arg);
+        }
+
+        ~ScopedEvent() noexcept
+        {
+            buffer.end (name, arg);
+        }
+
+    private:
+        TraceBuffer& buffer;
+        const char* const name;
+        const int arg;
+
+        JUCE_DECLARE_NON_COPYABLE (ScopedEvent);
+    };
+
+private:
+    inline void push (const char* name, const int arg, const char phase) noexcept
+    {
+        if (! isEnabled())
+            return;
+        int start1, size1, start2, size2;
+        fifo.prepareToWrite (1, start1, size1, start2, size2);
+        if (size1 == 0)
+        {
+            ++dropped;
+            return;
+        }
+        TraceEvent& e = events[start1];
+        e.ticks = Time::getHighResolutionTicks();
+        e.name = name;
+        e.arg = arg;
+        e.phase = phase;
+        fifo.finishedWrite (1);
+    }
+
+    AbstractFifo fifo;
+    HeapBlock<TraceEvent> events;
+    Atomic<int> enabled, dropped;
+    const int instanceId;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (TraceBuffer);
+};
+
+//==============================================================================
+/**
+ * Process-wide background thread that drains the TraceBuffer of every
+ * registered instance into a Chrome trace JSON file, which can be opened in
+ * chrome://tracing or Perfetto. Each instance appears as its own track.
+ *
+ * Share it between instances with a SharedResourcePointer.
+ */
+class TraceWriter : private Thread
+{
+public:
+    TraceWriter();
+    ~TraceWriter();
+
+    // Called from the message thread as instances are created and destroyed
+    void addBuffer (TraceBuffer* buffer);
+    void removeBuffer (TraceBuffer* buffer);
+
+    // Opens the file and enables tracing on every registered instance.
+    // Returns false if the file couldn't be opened.
+    bool startWriting (const File& file);
+    // Disables tracing, writes any remaining events and closes the file
+    void stopWriting();
+    bool isWriting() const noexcept { return output != nullptr; }
+
+private:
+    void run() override;
+    void drainAll();
+    void writeEvent (const TraceEvent& event, const int instanceId);
+    void writeInstanceName (const TraceBuffer* buffer);
+
+    CriticalSection lock;
+    Array<TraceBuffer*> buffers;
+    std::unique_ptr<FileOutputStream> output;
+    HeapBlock<TraceEvent> scratch;
+    bool firstEvent;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (TraceWriter);
+};
+
+#if ASSIGNMENT1_TRACING
+ #define ASSIGNMENT1_TRACE_SCOPE(buffer, name, arg) \
+    TraceBuffer::ScopedEvent JUCE_JOIN_MACRO (traceEvent_, __LINE__) (buffer, name, arg)
+ #define ASSIGNMENT1_TRACE_INSTANT(buffer, name, arg) \
+    (buffer).instant (name, arg)
+#else
+ #define ASSIGNMENT1_TRACE_SCOPE(buffer, name, arg)
+ #define ASSIGNMENT1_TRACE_INSTANT(buffer, name, arg)  ((void) 0)
+#endif
+
+#endif
@@ -0,0 +1,85 @@
+#include "TruePeakDetector.h"
+
+int TruePeakDetector::getOversampling(const double sampleRate) noexcept
+{
+    return sampleRate < 96000.0 ? 4 : (sampleRate < 192000.0 ? 2 : 1);
+}
+
+void TruePeakDetector::designInterpolator(float taps[][kTapsPerPhase], const int oversampling) noexcept
+{
+    const int length = oversampling * kTapsPerPhase;
+    for(int phase = 0; phase < oversampling; ++phase) {
+        for(int tap = 0; tap < kTapsPerPhase; ++tap) {
+            const int n = phase + oversampling * tap;
+            const double t = (n - length / 2) / (double) oversampling;
+            const double sinc = (t == 0) ? 1.0 : std::sin(double_Pi * t) / (double_Pi * t);
+            const double window = 0.42 - 0.5 * std::cos(2.0 * double_Pi * n / length)
+                                + 0.08 * std::cos(4.0 * double_Pi * n / length);
+            taps[phase][tap] = (float) (sinc * window);
+        }
+    }
+}
+
+void TruePeakDetector::prepare(const double sampleRate, const int newNumStreams)
+{
+    numStreams = jmax(0, newNumStreams);
+    streams.allocate((size_t) jmax(1, numStreams), true);
+    oversampling = getOversampling(sampleRate);
+    designInterpolator(interpolator, oversampling);
+    reset();
+}
+
+void TruePeakDetector::reset() noexcept
+{
+    for(int s = 0; s < numStreams; ++s) {
+        for(int i = 0; i < kTapsPerPhase * 2; ++i)
+            streams[s].history[i] = 0;
+        streams[s].position = 0;
+        for(int i = 0; i < kLatency; ++i)
+            streams[s].delayed[i] = 0;
+        streams[s].delayPosition = 0;
+    }
+}
+
+void TruePeakDetector::copyStateFrom(const TruePeakDetector& other) noexcept
+{
+    jassert (other.numStreams == numStreams);
+    memcpy(streams, other.streams, sizeof(Stream) * (size_t) jmin(numStreams, other.numStreams));
+}
+
+void TruePeakDetector::process(const int stream, const float* in, float* out, const int numSamples) noexcept
+{
+    jassert (isPositiveAndBelow(stream, numStreams));
+    Stream& state = streams[stream];
+    int position = state.position;
+    for(int i = 0; i < numSamples; ++i) {
+        if(--position < 0)
+            position += kTapsPerPhase;
+        state.history[position] = state.history[position + kTapsPerPhase] = in[i];
+        const float* history = state.history + position;
+        float peak = 0;
+        for(int phase = 0; phase < oversampling; ++phase) {
+            float y = 0;
+            for(int tap = 0; tap < kTapsPerPhase; ++tap)
+                y += interpolator[phase][tap] * history[tap];
+            peak = jmax(peak, std::abs(y));
+        }
+        out[i] = peak;
+    }
+    state.position = position;
+}
+
+void TruePeakDetector::delay(const int stream, float* samples, const int numSamples) noexcept
+{
+    jassert (isPositiveAndBelow(stream, numStreams));
+    Stream& state = streams[stream];
+    int position = state.delayPosition;
+    for(int i = 0; i < numSamples; ++i) {
+        const float sample = samples[i];
+        samples[i] = state.delayed[position];
+        state.delayed[position] = sample;
+        if(++position == kLatency)
+            position = 0;
+    }
+    state.delayPosition = position;
+}
@@ -0,0 +1,68 @@
+#ifndef __TRUEPEAKDETECTOR_H__
+#define __TRUEPEAKDETECTOR_H__
+
+#include "JuceHeader.h"
+
+//==============================================================================
+/**
+ * Magnitude of a signal including the peaks between its samples, found by
+ * oversampling (4x below 96kHz, 2x below 192kHz, as for BS.1770 true peak)
+ * with a Blackman windowed sinc interpolator.
+ *
+ * Keeps the interpolator history of any number of independent streams, all
+ * allocated in prepare(). The peaks come out kLatency samples late, and
+ * delay() holds a signal back by as much to match.
+ */
+class TruePeakDetector
+{
+public:
+    TruePeakDetector() {}
+    ~TruePeakDetector() {}
+
+    enum
+    {
+        kTapsPerPhase = 12,
+        kMaxOversampling = 4,
+        kLatency = kTapsPerPhase / 2    // Samples the output lags the input by
+    };
+
+    static int getOversampling (const double sampleRate) noexcept;
+    // Interpolator cut off at the original Nyquist frequency, one set of
+    // taps for each output phase. Its first phase is a pure delay, so the
+    // sample peak is always included.
+    static void designInterpolator (float taps[][kTapsPerPhase], const int oversampling) noexcept;
+
+    void prepare (const double sampleRate, const int numStreams);
+    void reset() noexcept;
+    // Takes the interpolator history of a detector prepared the same way
+    void copyStateFrom (const TruePeakDetector& other) noexcept;
+
+    // Writes the largest magnitude over each sample period of the
+    // oversampled stream, kLatency samples late. in and out may be the same.
+    void process (const int stream, const float* in, float* out, const int numSamples) noexcept;
+    // Delays samples by kLatency, in place, to line a signal up with the
+    // peaks found in it (or in a key taken alongside it). Each stream has a
+    // delay line of its own, apart from its interpolator history.
+    void delay (const int stream, float* samples, const int numSamples) noexcept;
+
+    // Bytes allocated by prepare()
+    size_t getMemoryUsage() const noexcept { return sizeof (Stream) * (size_t) numStreams; }
+
+private:
+    struct Stream
+    {
+        float history[kTapsPerPhase * 2];   // Stored twice over so the taps never wrap
+        int position;
+        float delayed[kLatency];            // For delay()
+        int delayPosition;
+    };
+
+    HeapBlock<Stream> streams;
+    int numStreams = 0;
+    float interpolator[kMaxOversampling][kTapsPerPhase];
+    int oversampling = 1;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (TruePeakDetector);
+};
+
+#endif
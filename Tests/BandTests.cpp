@@ -0,0 +1,149 @@
+#include "JuceHeader.h"
+#include "ProcessorTestHelpers.h"
+
+//==============================================================================
+// Checks the per-band solo, mute and bypass controls against the bands
+// they should be equivalent to, and that a bypassed band comes back without
+// the gain reduction it had before it was bypassed
+class BandTests : public UnitTest
+{
+public:
+    BandTests() : UnitTest("Bands") {}
+
+    void runTest() override
+    {
+        AudioSampleBuffer input(2, kNumSamples);
+        ProcessorTestHelpers::fillInput(input, 0.5f);
+
+        beginTest("Soloing every band is the same as nothing set");
+        {
+            static const char* const soloAll[] = { "band1solo", "band2solo", "band3solo", "band4solo" };
+            AudioSampleBuffer plain, soloed;
+            render(input, plain, nullptr, 0);
+            render(input, soloed, soloAll, numElementsInArray(soloAll));
+            expectEquals(getMaxDifference(plain, soloed, 0), 0.0f);
+            expect(plain.getMagnitude(0, kNumSamples) > 0.01f, "Render is silent");
+        }
+
+        beginTest("Solo band 2 is the same as muting bands 1, 3 and 4");
+        {
+            static const char* const solo2[] = { "band2solo" };
+            static const char* const muteOthers[] = { "band1mute", "band3mute", "band4mute" };
+            AudioSampleBuffer soloed, muted;
+            render(input, soloed, solo2, numElementsInArray(solo2));
+            render(input, muted, muteOthers, numElementsInArray(muteOthers));
+            expectEquals(getMaxDifference(soloed, muted, 0), 0.0f);
+            expect(soloed.getMagnitude(0, kNumSamples) > 0.01f, "Band 2 is silent");
+        }
+
+        beginTest("Muting every band gives silence");
+        {
+            static const char* const muteAll[] = { "band1mute", "band2mute", "band3mute", "band4mute" };
+            AudioSampleBuffer muted;
+            render(input, muted, muteAll, numElementsInArray(muteAll));
+            expectEquals(muted.getMagnitude(0, kNumSamples), 0.0f);
+        }
+
+        beginTest("A bypassed band comes back without its old gain reduction");
+        checkBypassRelease();
+    }
+
+private:
+    enum
+    {
+        kSampleRate = 44100,
+        kBlockSize = 512,
+        kNumSamples = kSampleRate,
+        kNumBands = ProcessorTestHelpers::kNumBands
+    };
+
+    static void prepare(Assignment1Processor& processor)
+    {
+        processor.setPlayConfigDetails(2, 2, kSampleRate, kBlockSize);
+        processor.prepareToPlay(kSampleRate, kBlockSize);
+    }
+
+    // Processes buffer from start to end in place, a block at a time
+    static void process(Assignment1Processor& processor, AudioSampleBuffer& buffer, const int start, const int end)
+    {
+        AudioSampleBuffer block(buffer.getNumChannels(), kBlockSize);
+        MidiBuffer midi;
+        for(int n = start; n < end; n += kBlockSize) {
+            const int numSamples = jmin((int) kBlockSize, end - n);
+            block.setSize(buffer.getNumChannels(), numSamples, false, false, 1.0f);
+            for(int ch = 0; ch < buffer.getNumChannels(); ++ch)
+                block.copyFrom(ch, 0, buffer, ch, n, numSamples);
+            processor.processBlock(block, midi);
+            for(int ch = 0; ch < buffer.getNumChannels(); ++ch)
+                buffer.copyFrom(ch, n, block, ch, 0, numSamples);
+        }
+    }
+
+    // Renders input with every band compressing and the band controls
+    // named in switches on
+    static void render(const AudioSampleBuffer& input, AudioSampleBuffer& output,
+                       const char* const* switches, const int numSwitches)
+    {
+        Assignment1Processor processor;
+        ProcessorTestHelpers::compressAll(processor, 50.0f);
+        for(int i = 0; i < numSwitches; ++i)
+            ProcessorTestHelpers::setParameter(processor, switches[i], 1.0f);
+        prepare(processor);
+        output.makeCopyOf(input);
+        process(processor, output, 0, output.getNumSamples());
+    }
+
+    // Largest difference between a and b from start on
+    static float getMaxDifference(const AudioSampleBuffer& a, const AudioSampleBuffer& b, const int start)
+    {
+        float maxDifference = 0.0f;
+        for(int ch = 0; ch < a.getNumChannels(); ++ch) {
+            const float* x = a.getReadPointer(ch);
+            const float* y = b.getReadPointer(ch);
+            for(int n = start; n < a.getNumSamples(); ++n)
+                maxDifference = jmax(maxDifference, std::abs(x[n] - y[n]));
+        }
+        return maxDifference;
+    }
+
+    // Two processors with the slowest release: one compresses a loud signal
+    // and the other silence, then both bypass every band for the same quiet
+    // signal, long enough for their filters to forget the difference. Once
+    // the bands come back their compressors should have forgotten it too.
+    void checkBypassRelease()
+    {
+        const int third = (kNumSamples / 3 / kBlockSize) * kBlockSize;
+        AudioSampleBuffer loud(2, 3 * third), quiet(2, 3 * third);
+        ProcessorTestHelpers::fillInput(loud, 0.2f);
+        quiet.makeCopyOf(loud);
+        loud.applyGain(0, third, 4.0f);
+        quiet.clear(0, third);
+
+        Assignment1Processor a, b;
+        ProcessorTestHelpers::compressAll(a, 1000.0f);
+        ProcessorTestHelpers::compressAll(b, 1000.0f);
+        prepare(a);
+        prepare(b);
+        process(a, loud, 0, third);
+        process(b, quiet, 0, third);
+        for(int band = 1; band <= kNumBands; ++band) {
+            ProcessorTestHelpers::setParameter(a, "band" + String(band) + "bypass", 1.0f);
+            ProcessorTestHelpers::setParameter(b, "band" + String(band) + "bypass", 1.0f);
+        }
+        process(a, loud, third, 2 * third);
+        process(b, quiet, third, 2 * third);
+        for(int band = 1; band <= kNumBands; ++band) {
+            ProcessorTestHelpers::setParameter(a, "band" + String(band) + "bypass", 0.0f);
+            ProcessorTestHelpers::setParameter(b, "band" + String(band) + "bypass", 0.0f);
+        }
+        process(a, loud, 2 * third, 3 * third);
+        process(b, quiet, 2 * third, 3 * third);
+
+        const float maxDifference = getMaxDifference(loud, quiet, 2 * third);
+        logMessage("Maximum difference after the bypass " + String(Decibels::gainToDecibels(maxDifference, -200.0f)) + "dB");
+        expect(maxDifference < 1.0e-5f, "Bands came back with their old gain reduction, out by " + String(maxDifference));
+        expect(quiet.getMagnitude(2 * third, third) > 0.01f, "Render is silent");
+    }
+};
+
+static BandTests bandTests;
@@ -0,0 +1,131 @@
+#include "JuceHeader.h"
+#include "../Source/Compressor.h"
+#include <cmath>
+
+//==============================================================================
+// Measures what running the gain computer at control rate costs in accuracy
+// and saves in time, at each interval from kMinControlInterval to
+// kMaxControlInterval, against the audio rate path on the same signal. The
+// table it logs is the benchmark; the checks hold the RMS detector, which
+// the processor uses, to the figures given for
+// Compressor::compressControlRate. The peak detector is only logged.
+class ControlRateTests : public UnitTest
+{
+public:
+    ControlRateTests() : UnitTest("Control rate") {}
+
+    void runTest() override
+    {
+        const DSPKernels& kernels = DSPKernels::getBest();
+        logMessage(String("Kernels: ") + kernels.name);
+
+        input.allocate(kNumSamples, false);
+        reference.allocate(kNumSamples, false);
+        gains.allocate(kNumSamples, false);
+        scratch.allocate(kBlockSize, false);
+        fillInput();
+
+        beginTest("Audio rate reference");
+        const double audioRateTime = run(kernels, 1, Compressor::kExponentialInterpolation,
+                                         Compressor::kBlockPeak, reference);
+        logMessage("interval  detector  interpolation  max error  rms error  ns/sample  speed-up");
+        logMessage("1         -         -              0dB        0dB        " + String(audioRateTime * 1.0e9 / kNumSamples, 2)
+                   + "      1");
+
+        for(int i = 0; i < 4; ++i) {
+            const Compressor::BlockDetector detector = (i < 2) ? Compressor::kBlockPeak : Compressor::kBlockRMS;
+            const Compressor::Interpolation interpolation = (i % 2 == 0) ? Compressor::kLinearInterpolation
+                                                                          : Compressor::kExponentialInterpolation;
+            const String detectorName = detector == Compressor::kBlockPeak ? "peak" : "RMS";
+            const String name = interpolation == Compressor::kLinearInterpolation ? "linear" : "exponential";
+            beginTest("Control rate, " + detectorName + " detector, " + name + " interpolation");
+            for(int interval = Compressor::kMinControlInterval; interval <= Compressor::kMaxControlInterval; interval *= 2) {
+                const double time = run(kernels, interval, interpolation, detector, gains);
+                double maxError = 0, sumSquares = 0;
+                for(int n = 0; n < kNumSamples; ++n) {
+                    const double error = std::abs(Decibels::gainToDecibels((double) gains[n])
+                                                  - Decibels::gainToDecibels((double) reference[n]));
+                    maxError = jmax(maxError, error);
+                    sumSquares += error * error;
+                }
+                const double rmsError = std::sqrt(sumSquares / kNumSamples);
+                logMessage(String(interval).paddedRight(' ', 10) + detectorName.paddedRight(' ', 10) + name.paddedRight(' ', 15)
+                           + (String(maxError, 3) + "dB").paddedRight(' ', 11)
+                           + (String(rmsError, 3) + "dB").paddedRight(' ', 11)
+                           + String(time * 1.0e9 / kNumSamples, 2).paddedRight(' ', 11)
+                           + String(audioRateTime / time, 1));
+
+                if(detector == Compressor::kBlockRMS) {
+                    const String where = " at interval " + String(interval);
+                    expect(rmsError < (interval <= 16 ? kMaxRmsErrorDb : kMaxRmsErrorLongDb),
+                           "RMS error " + String(rmsError) + "dB" + where);
+                    expect(maxError < (interval <= 16 ? kMaxPeakErrorDb : kMaxPeakErrorLongDb),
+                           "Peak error " + String(maxError) + "dB" + where);
+                }
+                if(interval >= 16)
+                    expect(time < audioRateTime, "Interval " + String(interval) + " is slower than audio rate");
+            }
+        }
+    }
+
+private:
+    enum
+    {
+        kSampleRate = 44100,
+        kBlockSize = 512,
+        kNumSamples = kSampleRate * 4,
+        kRepeats = 5
+    };
+    // Error allowed up to an interval of 16, and beyond
+    static constexpr double kMaxRmsErrorDb = 0.2, kMaxPeakErrorDb = 1.0;
+    static constexpr double kMaxRmsErrorLongDb = 0.4, kMaxPeakErrorLongDb = 2.0;
+
+    // Bursts of tone and noise with sharp onsets and decays at a range of
+    // levels, so that the compressor spends time attacking, releasing and
+    // holding
+    void fillInput()
+    {
+        Random random (1);
+        const int burstLength = kSampleRate / 8;
+        float level = 0;
+        for(int n = 0; n < kNumSamples; ++n) {
+            if(n % burstLength == 0)
+                level = Decibels::decibelsToGain(-50.0f + 50.0f * random.nextFloat());
+            const float decay = std::exp(-8.0f * (n % burstLength) / burstLength);
+            input[n] = level * decay * (0.7f * std::sin(n * 0.05f) + 0.3f * (random.nextFloat() * 2.0f - 1.0f));
+        }
+    }
+
+    // Gains of the compressor over the whole signal, a block at a time.
+    // Returns the fastest of kRepeats runs in seconds.
+    double run(const DSPKernels& kernels, const int interval, const Compressor::Interpolation interpolation,
+               const Compressor::BlockDetector detector, float* dest)
+    {
+        double fastest = 0;
+        for(int repeat = 0; repeat < kRepeats; ++repeat) {
+            Compressor compressor;
+            compressor.setKernels(kernels);
+            compressor.setScratch(scratch, kBlockSize);
+            compressor.setSampleRate(kSampleRate);
+            compressor.setThreshold(-30.0f);
+            compressor.setRatio(4.0f);
+            compressor.setAttackTime(10.0f);
+            compressor.setReleaseTime(100.0f);
+            compressor.setControlRate(interval, interpolation, detector);
+            compressor.compressorONOFF = true;
+
+            // The gain is applied to a signal of ones, leaving just the gain
+            FloatVectorOperations::fill(dest, 1.0f, kNumSamples);
+            const int64 start = Time::getHighResolutionTicks();
+            for(int n = 0; n < kNumSamples; n += kBlockSize)
+                compressor.processSamples(input + n, dest + n, jmin((int) kBlockSize, kNumSamples - n));
+            const double seconds = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - start);
+            fastest = (repeat == 0) ? seconds : jmin(fastest, seconds);
+        }
+        return fastest;
+    }
+
+    HeapBlock<float> input, reference, gains, scratch;
+};
+
+static ControlRateTests controlRateTests;
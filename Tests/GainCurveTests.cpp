@@ -0,0 +1,119 @@
+#include "JuceHeader.h"
+#include "../Source/GainCurve.h"
+#include "../Source/DSPKernels.h"
+#include <cmath>
+
+//==============================================================================
+// Holds the gain computer to the accuracy documented for it: the table of
+// GainCurve against the analytic compressor curve, inside the knee and out,
+// and the log2/exp2 approximations of every DSPKernels variant against the
+// library functions
+class GainCurveTests : public UnitTest
+{
+public:
+    GainCurveTests() : UnitTest("GainCurve") {}
+
+    void runTest() override
+    {
+        beginTest("Table against the analytic curve");
+        // Thresholds on a table entry and between entries, hard knees,
+        // knees narrower than an entry and wide ones
+        const float thresholds[] = { -30.0f, -20.1f, -17.37f };
+        const float ratios[] = { 2.0f, 4.0f, 100.0f };
+        const float kneeWidths[] = { 0.0f, 0.1f, 0.5f, 1.0f, 6.0f, 24.0f };
+        for(const float threshold : thresholds)
+            for(const float ratio : ratios)
+                for(const float kneeWidth : kneeWidths)
+                    checkTable(threshold, ratio, kneeWidth);
+
+        beginTest("Level and gain approximations");
+        for(int isa = 0; isa < DSPKernels::kNumIsas; ++isa)
+            if(DSPKernels::isSupported((DSPKernels::Isa) isa))
+                checkApproximations(DSPKernels::get((DSPKernels::Isa) isa));
+    }
+
+private:
+    enum { kPointsPerDecibel = 1000 };
+    // Float rounding of gain reductions up to about 100dB
+    static constexpr double kRounding = 1.0e-4;
+    static constexpr double kMaxApproximationErrorDb = 1.0e-4;
+
+    // Gain reduction of the soft knee compressor of Giannoulis, Massberg and
+    // Reiss, worked out in double precision
+    static double getReduction(const double x, const double threshold, const double ratio, const double kneeWidth)
+    {
+        const double overshoot = 2.0 * (x - threshold);
+        if(overshoot < -kneeWidth)
+            return 0.0;
+        if(overshoot <= kneeWidth && kneeWidth > 0.0) {
+            const double d = x - threshold + kneeWidth / 2.0;
+            return (1.0 - 1.0 / ratio) * d * d / (2.0 * kneeWidth);
+        }
+        return (x - threshold) * (1.0 - 1.0 / ratio);
+    }
+
+    void checkTable(const float threshold, const float ratio, const float kneeWidth)
+    {
+        GainCurve curve;
+        curve.setParameters(GainCurve::kCompressor, threshold, ratio, kneeWidth);
+
+        const double slopeChange = 1.0 - 1.0 / ratio;
+        const double step = 1.0 / GainCurve::kStepsPerDecibel;
+        const double hardKneeBound = slopeChange * step / 4.0;
+        const double kneeBound = kneeWidth > 0 ? jmin(hardKneeBound, slopeChange * step * step / (8.0 * kneeWidth))
+                                               : hardKneeBound;
+
+        double maxError = 0, maxKneeError = 0, maxStraightError = 0;
+        const int numPoints = (int) ((GainCurve::kMaxLevel - GainCurve::kMinLevel) * kPointsPerDecibel);
+        for(int i = 0; i <= numPoints; ++i) {
+            const double x = GainCurve::kMinLevel + (double) i / kPointsPerDecibel;
+            const double error = std::abs(curve.getGainReduction((float) x) - getReduction(x, threshold, ratio, kneeWidth));
+            maxError = jmax(maxError, error);
+            // Straight sections away from the knee, by more than an entry
+            const double distance = std::abs(x - threshold) - kneeWidth / 2.0;
+            if(distance <= 0)
+                maxKneeError = jmax(maxKneeError, error);
+            else if(distance > step)
+                maxStraightError = jmax(maxStraightError, error);
+        }
+        const String settings = "threshold " + String(threshold) + "dB, ratio " + String(ratio)
+                              + ", knee " + String(kneeWidth) + "dB";
+        expect(maxError <= hardKneeBound + kRounding, "Error " + String(maxError) + "dB with " + settings);
+        expect(maxKneeError <= kneeBound + kRounding, "Error in the knee " + String(maxKneeError) + "dB with " + settings);
+        expect(maxStraightError <= kRounding, "Error off the knee " + String(maxStraightError) + "dB with " + settings);
+    }
+
+    void checkApproximations(const DSPKernels& kernels)
+    {
+        // A curve with an output of 0dB everywhere makes the gain reduction
+        // equal to the input level
+        GainCurve levelCurve;
+        levelCurve.setCustomCurve([] (float) { return 0.0f; });
+
+        enum { kNumSamples = 4096 };
+        HeapBlock<float> samples(kNumSamples), result(kNumSamples), reduction(kNumSamples);
+        // Levels within the table, both signs
+        for(int i = 0; i < kNumSamples; ++i) {
+            const double level = GainCurve::kMinLevel + 1.0 + i * (GainCurve::kMaxLevel - GainCurve::kMinLevel - 2.0) / kNumSamples;
+            samples[i] = (float) (std::pow(10.0, level / 20.0) * ((i & 1) != 0 ? -1.0 : 1.0));
+        }
+        kernels.gainComputer(levelCurve.getTable(), samples, result, kNumSamples);
+        double maxLevelError = 0;
+        for(int i = 0; i < kNumSamples; ++i)
+            maxLevelError = jmax(maxLevelError, std::abs(result[i] - 20.0 * std::log10(std::abs((double) samples[i]))));
+
+        for(int i = 0; i < kNumSamples; ++i)
+            reduction[i] = -60.0f + 120.0f * i / kNumSamples;
+        kernels.decibelsToGain(reduction, 0.0f, result, kNumSamples);
+        double maxGainError = 0;
+        for(int i = 0; i < kNumSamples; ++i)
+            maxGainError = jmax(maxGainError, std::abs(20.0 * std::log10((double) result[i]) + reduction[i]));
+
+        logMessage(String(kernels.name) + ": level within " + String(maxLevelError, 7) + "dB, gain within "
+                   + String(maxGainError, 7) + "dB");
+        expect(maxLevelError < kMaxApproximationErrorDb, String(kernels.name) + " level error " + String(maxLevelError) + "dB");
+        expect(maxGainError < kMaxApproximationErrorDb, String(kernels.name) + " gain error " + String(maxGainError) + "dB");
+    }
+};
+
+static GainCurveTests gainCurveTests;
@@ -0,0 +1,47 @@
+#include "JuceHeader.h"
+#include "StressTester.h"
+
+//==============================================================================
+// Runs every UnitTest linked in, or with --stress the StressTester:
+//
+//     Assignment1Tests
+//     Assignment1Tests --stress [seconds] [seed]
+//
+// and returns non-zero if anything failed
+static int runUnitTests()
+{
+    UnitTestRunner runner;
+    runner.runAllTests();
+
+    int numFailures = 0;
+    for(int i = 0; i < runner.getNumResults(); ++i)
+        numFailures += runner.getResult(i)->failures;
+    return numFailures == 0 ? 0 : 1;
+}
+
+static int runStressTest(const StringArray& args)
+{
+    StressTester::Settings settings;
+    if(args.size() > 2)
+        settings.durationSeconds = args[2].getDoubleValue();
+    if(args.size() > 3)
+        settings.seed = args[3].getLargeIntValue();
+
+    StressTester tester(settings);
+    const StressTester::Report report = tester.run();
+    std::cout << report.toString() << std::endl;
+    return report.passed() ? 0 : 1;
+}
+
+int main(int argc, char* argv[])
+{
+    ScopedJuceInitialiser_GUI juceInitialiser;
+
+    StringArray args;
+    for(int i = 0; i < argc; ++i)
+        args.add(String::fromUTF8(argv[i]));
+
+    if(args.size() > 1 && args[1] == "--stress")
+        return runStressTest(args);
+    return runUnitTests();
+}
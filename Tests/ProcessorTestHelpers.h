@@ -0,0 +1,64 @@
+#ifndef __PROCESSORTESTHELPERS_H__
+#define __PROCESSORTESTHELPERS_H__
+
+#include "JuceHeader.h"
+#include "../Source/PluginProcessor.h"
+#include <cmath>
+
+//==============================================================================
+/**
+ * Set-up shared by the unit tests that run the whole processor: test
+ * signals, and parameters set by ID as a host's generic editor would.
+ */
+class ProcessorTestHelpers
+{
+public:
+    enum { kNumBands = 4 };
+
+    // Sets a float parameter to value, or a bool one on if value is non-zero
+    static void setParameter(Assignment1Processor& processor, const String& paramID, const float value)
+    {
+        const OwnedArray<AudioProcessorParameter>& parameters = processor.getParameters();
+        for(int i = 0; i < parameters.size(); ++i) {
+            AudioProcessorParameterWithID* parameter = dynamic_cast<AudioProcessorParameterWithID*>(parameters[i]);
+            if(parameter == nullptr || parameter->paramID != paramID)
+                continue;
+            if(AudioParameterFloat* floatParameter = dynamic_cast<AudioParameterFloat*>(parameter))
+                *floatParameter = value;
+            else if(AudioParameterBool* boolParameter = dynamic_cast<AudioParameterBool*>(parameter))
+                *boolParameter = value != 0.0f;
+            return;
+        }
+        jassertfalse;
+    }
+
+    // Every band compressing hard, so that the bands don't just add back up
+    // to the input
+    static void compressAll(Assignment1Processor& processor, const float releaseMs)
+    {
+        for(int band = 1; band <= kNumBands; ++band) {
+            const String prefix = "comp" + String(band);
+            setParameter(processor, prefix + "active", 1.0f);
+            setParameter(processor, prefix + "thresh", -30.0f);
+            setParameter(processor, prefix + "ratio", 4.0f);
+            setParameter(processor, prefix + "attack", 5.0f);
+            setParameter(processor, prefix + "release", releaseMs);
+        }
+    }
+
+    // A tone and noise, swelling so that the compressors keep moving. The
+    // same signal every time.
+    static void fillInput(AudioSampleBuffer& input, const float level)
+    {
+        Random random (1);
+        for(int ch = 0; ch < input.getNumChannels(); ++ch) {
+            float* samples = input.getWritePointer(ch);
+            for(int n = 0; n < input.getNumSamples(); ++n) {
+                const float swell = 0.5f + 0.5f * std::sin(n * 0.0003f);
+                samples[n] = level * (swell * std::sin(n * 0.01f * (ch + 1)) + 0.2f * (random.nextFloat() - 0.5f));
+            }
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,220 @@
+#include "../Source/RealtimeSafety.h"
+
+Atomic<int64> RealtimeSafety::counts[RealtimeSafety::kNumViolations];
+
+void RealtimeSafety::resetCounts() noexcept
+{
+    for(int i = 0; i < kNumViolations; ++i)
+        counts[i].set(0);
+}
+
+const char* RealtimeSafety::getName(const Violation violation) noexcept
+{
+    switch(violation) {
+        case kAllocation:       return "allocation";
+        case kDeallocation:     return "deallocation";
+        case kLock:             return "lock";
+        case kWait:             return "wait";
+        default:                return "unknown";
+    }
+}
+
+//==============================================================================
+#if ASSIGNMENT1_RT_CHECKS
+ #if defined (__GLIBC__)
+
+#include <dlfcn.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <errno.h>
+
+// The real pthread and semaphore functions are looked up on first use. Two
+// threads looking one up at once both find the same function, so there's
+// no need to guard it (which would need a lock).
+template <typename Function>
+static Function findNext(Function& function, const char* name) noexcept
+{
+    if(function == nullptr)
+        function = (Function) dlsym(RTLD_NEXT, name);
+    return function;
+}
+
+typedef int (*MutexFunction) (pthread_mutex_t*);
+typedef int (*RWLockFunction) (pthread_rwlock_t*);
+typedef int (*CondWaitFunction) (pthread_cond_t*, pthread_mutex_t*);
+typedef int (*CondTimedWaitFunction) (pthread_cond_t*, pthread_mutex_t*, const struct timespec*);
+typedef int (*SemaphoreFunction) (sem_t*);
+static MutexFunction realMutexLock = nullptr, realMutexTryLock = nullptr;
+static RWLockFunction realReadLock = nullptr, realTryReadLock = nullptr;
+static RWLockFunction realWriteLock = nullptr, realTryWriteLock = nullptr;
+static CondWaitFunction realCondWait = nullptr;
+static CondTimedWaitFunction realCondTimedWait = nullptr;
+static SemaphoreFunction realSemaphoreWait = nullptr;
+
+// glibc's own entry points, which the replacements below pass calls on to.
+// Replacing malloc itself also catches operator new, JUCE's HeapBlock and
+// everything else built on it.
+extern "C"
+{
+void* __libc_malloc (size_t);
+void* __libc_calloc (size_t, size_t);
+void* __libc_realloc (void*, size_t);
+void* __libc_memalign (size_t, size_t);
+void __libc_free (void*);
+
+void* malloc(size_t size) __THROW
+{
+    RealtimeSafety::check(RealtimeSafety::kAllocation);
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size) __THROW
+{
+    RealtimeSafety::check(RealtimeSafety::kAllocation);
+    return __libc_calloc(count, size);
+}
+
+void* realloc(void* pointer, size_t size) __THROW
+{
+    RealtimeSafety::check(RealtimeSafety::kAllocation);
+    return __libc_realloc(pointer, size);
+}
+
+void* memalign(size_t alignment, size_t size) __THROW
+{
+    RealtimeSafety::check(RealtimeSafety::kAllocation);
+    return __libc_memalign(alignment, size);
+}
+
+void* aligned_alloc(size_t alignment, size_t size) __THROW
+{
+    RealtimeSafety::check(RealtimeSafety::kAllocation);
+    return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void** result, size_t alignment, size_t size) __THROW
+{
+    RealtimeSafety::check(RealtimeSafety::kAllocation);
+    *result = __libc_memalign(alignment, size);
+    return *result != nullptr || size == 0 ? 0 : ENOMEM;
+}
+
+void free(void* pointer) __THROW
+{
+    if(pointer != nullptr)
+        RealtimeSafety::check(RealtimeSafety::kDeallocation);
+    __libc_free(pointer);
+}
+
+// A try-lock never blocks, but the thread holding the lock can, so it
+// counts as much as a lock does
+int pthread_mutex_lock(pthread_mutex_t* mutex) __THROWNL
+{
+    RealtimeSafety::check(RealtimeSafety::kLock);
+    return findNext(realMutexLock, "pthread_mutex_lock")(mutex);
+}
+
+int pthread_mutex_trylock(pthread_mutex_t* mutex) __THROWNL
+{
+    RealtimeSafety::check(RealtimeSafety::kLock);
+    return findNext(realMutexTryLock, "pthread_mutex_trylock")(mutex);
+}
+
+int pthread_rwlock_rdlock(pthread_rwlock_t* lock) __THROWNL
+{
+    RealtimeSafety::check(RealtimeSafety::kLock);
+    return findNext(realReadLock, "pthread_rwlock_rdlock")(lock);
+}
+
+int pthread_rwlock_tryrdlock(pthread_rwlock_t* lock) __THROWNL
+{
+    RealtimeSafety::check(RealtimeSafety::kLock);
+    return findNext(realTryReadLock, "pthread_rwlock_tryrdlock")(lock);
+}
+
+int pthread_rwlock_wrlock(pthread_rwlock_t* lock) __THROWNL
+{
+    RealtimeSafety::check(RealtimeSafety::kLock);
+    return findNext(realWriteLock, "pthread_rwlock_wrlock")(lock);
+}
+
+int pthread_rwlock_trywrlock(pthread_rwlock_t* lock) __THROWNL
+{
+    RealtimeSafety::check(RealtimeSafety::kLock);
+    return findNext(realTryWriteLock, "pthread_rwlock_trywrlock")(lock);
+}
+
+int pthread_cond_wait(pthread_cond_t* condition, pthread_mutex_t* mutex)
+{
+    RealtimeSafety::check(RealtimeSafety::kWait);
+    return findNext(realCondWait, "pthread_cond_wait")(condition, mutex);
+}
+
+int pthread_cond_timedwait(pthread_cond_t* condition, pthread_mutex_t* mutex, const struct timespec* time)
+{
+    RealtimeSafety::check(RealtimeSafety::kWait);
+    return findNext(realCondTimedWait, "pthread_cond_timedwait")(condition, mutex, time);
+}
+
+int sem_wait(sem_t* semaphore)
+{
+    RealtimeSafety::check(RealtimeSafety::kWait);
+    return findNext(realSemaphoreWait, "sem_wait")(semaphore);
+}
+}
+
+ #else
+
+#include <new>
+#include <cstdlib>
+
+// Without glibc only C++ allocations can be caught portably, and locks not
+// at all
+void* operator new(size_t size)
+{
+    RealtimeSafety::check(RealtimeSafety::kAllocation);
+    if(void* pointer = std::malloc(size))
+        return pointer;
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    RealtimeSafety::check(RealtimeSafety::kAllocation);
+    return std::malloc(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+    return operator new(size, std::nothrow);
+}
+
+void operator delete(void* pointer) noexcept
+{
+    if(pointer != nullptr)
+        RealtimeSafety::check(RealtimeSafety::kDeallocation);
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept
+{
+    operator delete(pointer);
+}
+
+void operator delete(void* pointer, const std::nothrow_t&) noexcept
+{
+    operator delete(pointer);
+}
+
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept
+{
+    operator delete(pointer);
+}
+
+ #endif
+#endif
@@ -0,0 +1,255 @@
+#include "StressTester.h"
+#include <cfloat>
+#include <cmath>
+
+//==============================================================================
+// Makes the changes a host and editor make, as fast as parameterIntervalMs
+// allows. Hosts make them from threads of their own as well as from the
+// message thread.
+class StressTester::ParameterThread : public Thread
+{
+public:
+    ParameterThread(Assignment1Processor& p, const int interval, const int64 seed, const int maxOffset)
+        : Thread("Stress parameters"), processor(p), random(seed), intervalMs(interval), maxSampleOffset(maxOffset)
+    {
+    }
+
+    void run() override
+    {
+        const int numParameters = processor.getNumParameters();
+        while(! threadShouldExit()) {
+            const int choice = random.nextInt(100);
+            if(choice < 2)
+                processor.setCurrentProgram(random.nextInt(processor.getNumPrograms()));
+            else if(choice < 30)
+                processor.queueParameterChange(random.nextInt(numParameters), random.nextFloat(),
+                                               random.nextInt(maxSampleOffset + 1));
+            else
+                processor.setParameter(random.nextInt(numParameters), random.nextFloat());
+            ++numChanges;
+            wait(random.nextInt(intervalMs + 1));
+        }
+    }
+
+    Atomic<int64> numChanges;
+
+private:
+    Assignment1Processor& processor;
+    Random random;
+    const int intervalMs, maxSampleOffset;
+};
+
+//==============================================================================
+// Plays the host's audio thread for a session, so that the thread that
+// called run() is free to deliver the processor's messages
+class StressTester::AudioThread : public Thread
+{
+public:
+    AudioThread(StressTester& t, Report& r) : Thread("Stress audio"), tester(t), report(r) {}
+
+    void run() override
+    {
+        tester.playSession(report);
+    }
+
+private:
+    StressTester& tester;
+    Report& report;
+};
+
+//==============================================================================
+StressTester::StressTester(const Settings& s)
+    : settings(s), random(s.seed)
+{
+}
+
+StressTester::~StressTester()
+{
+    stopParameterThread();
+}
+
+StressTester::Report StressTester::run()
+{
+    Report report;
+    RealtimeSafety::resetCounts();
+    endTime = Time::getMillisecondCounterHiRes() + settings.durationSeconds * 1000.0;
+    while(Time::getMillisecondCounterHiRes() < endTime) {
+        runSession(report);
+        ++report.numSessions;
+    }
+    report.numParameterChanges += stopParameterThread();
+    processor = nullptr;
+
+    for(int i = 0; i < RealtimeSafety::kNumViolations; ++i)
+        report.violations[i] = RealtimeSafety::getCount((RealtimeSafety::Violation) i);
+    return report;
+}
+
+void StressTester::runSession(Report& report)
+{
+    static const double sampleRates[] = { 22050, 44100, 48000, 88200, 96000, 176400, 192000 };
+    sampleRate = sampleRates[random.nextInt(numElementsInArray(sampleRates))];
+    blockSize = 1 + random.nextInt(jmax(1, settings.maxBlockSize));
+
+    // Hosts either prepare the instance they have again or start a new
+    // one. Nothing else touches it while it is being prepared.
+    report.numParameterChanges += stopParameterThread();
+    if(processor == nullptr || random.nextBool())
+        processor.reset(new Assignment1Processor());
+    else
+        processor->releaseResources();
+    processor->setNonRealtime(random.nextInt(4) == 0);
+    processor->setPlayConfigDetails(settings.numChannels, settings.numChannels, sampleRate, blockSize);
+    processor->prepareToPlay(sampleRate, blockSize);
+    // As if an editor were showing the analyser
+    processor->getSpectrumAnalyser().setActive(random.nextBool());
+
+    parameterThread.reset(new ParameterThread(*processor, settings.parameterIntervalMs, random.nextInt64(), blockSize));
+    parameterThread->startThread();
+
+    // Whatever the audio thread leaves for the message thread is picked up
+    // here, while it plays
+    AudioThread audioThread(*this, report);
+    audioThread.startThread();
+    while(audioThread.isThreadRunning())
+        MessageManager::getInstance()->runDispatchLoopUntil(kDispatchIntervalMs);
+}
+
+void StressTester::playSession(Report& report)
+{
+    const int numBufferChannels = jmax(processor->getTotalNumInputChannels(), processor->getTotalNumOutputChannels());
+    const int64 sessionSamples = (int64) (settings.sessionSeconds * sampleRate * (0.5 + random.nextDouble()));
+    for(int64 done = 0; done < sessionSamples && Time::getMillisecondCounterHiRes() < endTime; ) {
+        // Mostly whole blocks, but hosts send short and even empty ones too
+        const int kind = random.nextInt(8);
+        const int numSamples = (kind < 5) ? blockSize
+                             : (kind < 7 ? random.nextInt(blockSize + 1) : jmin(blockSize, 1 + random.nextInt(16)));
+        buffer.setSize(numBufferChannels, numSamples, false, false, true);
+        fillInput(numSamples);
+
+        int64 before[RealtimeSafety::kNumViolations];
+        for(int i = 0; i < RealtimeSafety::kNumViolations; ++i)
+            before[i] = RealtimeSafety::getCount((RealtimeSafety::Violation) i);
+
+        const int64 start = Time::getHighResolutionTicks();
+        {
+            RealtimeSafety::ScopedRealtime realtime;
+            processor->processBlock(buffer, midi);
+        }
+        const double seconds = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - start);
+
+        if(seconds * 1000.0 > report.worstBlockMs) {
+            report.worstBlockMs = seconds * 1000.0;
+            report.worstBlock = describeBlock(report.numBlocks, numSamples);
+        }
+        // Hosts send short blocks within a callback of the full period
+        const double load = seconds * sampleRate / blockSize;
+        if(load > report.worstLoad) {
+            report.worstLoad = load;
+            report.worstLoadBlock = describeBlock(report.numBlocks, numSamples);
+        }
+        for(int i = 0; i < RealtimeSafety::kNumViolations && report.firstProblem.isEmpty(); ++i) {
+            if(RealtimeSafety::getCount((RealtimeSafety::Violation) i) != before[i])
+                report.firstProblem = String(RealtimeSafety::getName((RealtimeSafety::Violation) i)) + " in "
+                                    + describeBlock(report.numBlocks, numSamples);
+        }
+        checkOutput(report, numSamples);
+
+        ++report.numBlocks;
+        report.numSamples += numSamples;
+        done += jmax(1, numSamples);
+    }
+}
+
+// Returns the number of changes it made
+int64 StressTester::stopParameterThread()
+{
+    if(parameterThread == nullptr)
+        return 0;
+    parameterThread->stopThread(1000);
+    const int64 numChanges = parameterThread->numChanges.get();
+    parameterThread = nullptr;
+    return numChanges;
+}
+
+// Switches to another kind of signal every so often
+void StressTester::fillInput(const int numSamples)
+{
+    if(--signalBlocksLeft < 0) {
+        signal = (Signal) random.nextInt(kNumSignals);
+        signalBlocksLeft = random.nextInt(kSignalChangeBlocks);
+        increment = 2.0 * double_Pi * (20.0 + random.nextDouble() * 0.45 * sampleRate) / sampleRate;
+    }
+    const double startPhase = phase;
+    for(int ch = 0; ch < buffer.getNumChannels(); ++ch) {
+        float* samples = buffer.getWritePointer(ch);
+        phase = startPhase;
+        for(int i = 0; i < numSamples; ++i) {
+            switch(signal) {
+                case kTone:         samples[i] = 0.5f * (float) std::sin(phase + ch); break;
+                case kNoise:        samples[i] = random.nextFloat() * 2.0f - 1.0f; break;
+                case kFullScale:    samples[i] = random.nextBool() ? 1.0f : -1.0f; break;
+                case kTiny:         samples[i] = (random.nextFloat() * 2.0f - 1.0f) * 1.0e-30f; break;
+                default:            samples[i] = 0; break;
+            }
+            phase += increment;
+        }
+    }
+    phase = std::fmod(phase, 2.0 * double_Pi);
+}
+
+void StressTester::checkOutput(Report& report, const int numSamples)
+{
+    int64 numNonFinite = 0, numDenormal = 0;
+    for(int ch = 0; ch < jmin(buffer.getNumChannels(), processor->getTotalNumOutputChannels()); ++ch) {
+        const float* samples = buffer.getReadPointer(ch);
+        for(int i = 0; i < numSamples; ++i) {
+            if(! std::isfinite(samples[i]))
+                ++numNonFinite;
+            else if(samples[i] != 0 && std::abs(samples[i]) < FLT_MIN)
+                ++numDenormal;
+        }
+    }
+    if(numNonFinite > 0 && report.firstProblem.isEmpty())
+        report.firstProblem = "non-finite output in " + describeBlock(report.numBlocks, numSamples);
+    if(numDenormal > 0 && report.firstDenormal.isEmpty())
+        report.firstDenormal = describeBlock(report.numBlocks, numSamples);
+    report.numNonFinite += numNonFinite;
+    report.numDenormal += numDenormal;
+}
+
+String StressTester::describeBlock(const int64 blockIndex, const int numSamples) const
+{
+    return "block " + String(blockIndex) + " (" + String(numSamples) + " samples at "
+         + String(sampleRate) + "Hz" + (processor->isNonRealtime() ? ", offline" : "") + ")";
+}
+
+//==============================================================================
+// Denormals aren't failures in themselves, just slow, so they don't count
+bool StressTester::Report::passed() const noexcept
+{
+    for(int i = 0; i < RealtimeSafety::kNumViolations; ++i)
+        if(violations[i] != 0)
+            return false;
+    return numNonFinite == 0;
+}
+
+String StressTester::Report::toString() const
+{
+    String s;
+    s << numSessions << " sessions, " << numBlocks << " blocks, " << numSamples << " samples, "
+      << numParameterChanges << " parameter changes\n";
+    s << "Slowest block: " << worstBlockMs << "ms, " << worstBlock << "\n";
+    s << "Highest load: " << worstLoad * 100.0 << "% of real time, " << worstLoadBlock << "\n";
+    for(int i = 0; i < RealtimeSafety::kNumViolations; ++i)
+        s << RealtimeSafety::getName((RealtimeSafety::Violation) i) << "s: " << violations[i] << "\n";
+    if(! RealtimeSafety::isChecking())
+        s << "(allocations and locks aren't caught without ASSIGNMENT1_RT_CHECKS)\n";
+    s << "Non-finite output samples: " << numNonFinite << ", denormal output samples: " << numDenormal << "\n";
+    if(firstDenormal.isNotEmpty())
+        s << "First denormal output: " << firstDenormal << "\n";
+    if(firstProblem.isNotEmpty())
+        s << "First failure: " << firstProblem << "\n";
+    s << (passed() ? "PASSED" : "FAILED");
+    return s;
+}
@@ -0,0 +1,115 @@
+#ifndef __STRESSTESTER_H__
+#define __STRESSTESTER_H__
+
+#include "JuceHeader.h"
+#include "../Source/PluginProcessor.h"
+#include "../Source/RealtimeSafety.h"
+#include <memory>
+
+//==============================================================================
+/**
+ * Runs the plugin for as long as asked under the conditions that bring out
+ * the rare problems only seen as dropouts in real use, and reports them.
+ *
+ * The calling thread has to be the message thread, which it plays for the
+ * host, delivering the processor's timer callbacks. Another thread plays
+ * the host's audio thread. It goes through sessions, each at a random
+ * sample rate and maximum block size (and sometimes rendering offline),
+ * with either a fresh instance or the last one prepared again. Within a
+ * session, every block has a random size up to the maximum and the input
+ * keeps switching between tones, noise, full scale, near-silence and
+ * silence after loud signals. All the while a third thread sets random
+ * parameters, queues timestamped automation and changes program.
+ *
+ * Every block is timed against the callback period, and its output is
+ * checked for NaNs, infinities and denormals. Allocation, locking and
+ * waiting on the audio thread (and the DSP worker threads, while they work
+ * for it) are counted by RealtimeSafety, so the executable running this
+ * has to be built with ASSIGNMENT1_RT_CHECKS set to 1 for those to be
+ * caught. Assignment1Tests is, and runs this with --stress. Nothing else
+ * is needed: no editor and no audio device.
+ */
+class StressTester
+{
+public:
+    struct Settings
+    {
+        double durationSeconds = 60;    // Wall clock time to run for
+        double sessionSeconds = 10;     // Audio per session, on average
+        int maxBlockSize = 4096;
+        int numChannels = 2;
+        int parameterIntervalMs = 2;    // Longest pause between changes
+        int64 seed = 1;
+    };
+
+    struct Report
+    {
+        int numSessions = 0;
+        int64 numBlocks = 0, numSamples = 0, numParameterChanges = 0;
+
+        // Longest time processBlock took, and the largest fraction of the
+        // callback period (the session's maximum block size) it took, with
+        // the block each was seen on
+        double worstBlockMs = 0, worstLoad = 0;
+        String worstBlock, worstLoadBlock;
+
+        int64 violations[RealtimeSafety::kNumViolations] = {};
+        int64 numNonFinite = 0, numDenormal = 0;    // Output samples
+        String firstProblem;                        // Where the first failure was seen
+        String firstDenormal;
+
+        bool passed() const noexcept;
+        String toString() const;
+    };
+
+    StressTester (const Settings& settings);
+    ~StressTester();
+
+    // Call from the message thread. Blocks until the time is up.
+    Report run();
+
+private:
+    class ParameterThread;
+    class AudioThread;
+
+    void runSession (Report& report);
+    void playSession (Report& report);
+    int64 stopParameterThread();
+    void fillInput (const int numSamples);
+    void checkOutput (Report& report, const int numSamples);
+    String describeBlock (const int64 blockIndex, const int numSamples) const;
+
+    enum
+    {
+        kSignalChangeBlocks = 64,       // Longest run of blocks of one kind of input
+        kDispatchIntervalMs = 10        // How often the message thread checks the audio thread has finished
+    };
+
+    enum Signal
+    {
+        kTone = 0,
+        kNoise,
+        kFullScale,
+        kTiny,          // Around the denormal range
+        kSilence,       // Lets everything decay towards denormals
+        kNumSignals
+    };
+
+    Settings settings;
+    Random random;
+    std::unique_ptr<Assignment1Processor> processor;
+    std::unique_ptr<ParameterThread> parameterThread;
+
+    AudioSampleBuffer buffer;
+    MidiBuffer midi;
+    double sampleRate = 44100;
+    int blockSize = 0;
+    double endTime = 0;             // Millisecond counter
+    Signal signal = kTone;
+    int signalBlocksLeft = 0;
+    double phase = 0, increment = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (StressTester);
+};
+
+#endif